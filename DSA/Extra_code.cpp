@@ -3,6 +3,8 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <charconv>
 
 using namespace std;
 
@@ -120,6 +122,15 @@ vector<string> split(const string &line, char delimiter)
     return tokens;
 }
 
+// Function to convert a numeric token without throwing, an empty or malformed token reads as 0
+template <typename T>
+T parseNumber(const string &token)
+{
+    T value = 0;
+    from_chars(token.data(), token.data() + token.size(), value);
+    return value;
+}
+
 // Function to parse CSV file and populate vector of Movie objects
 vector<Movie> parseCSV(const string &filename, vector<bool> &remove_quotes)
 {
@@ -142,22 +153,19 @@ vector<Movie> parseCSV(const string &filename, vector<bool> &remove_quotes)
 
         // Fill movie struct with tokens
         movie.title = tokens[1];
-        movie.vote_average = stof(tokens[2]);
-        movie.vote_count = stoi(tokens[3]);
+        movie.vote_average = parseNumber<float>(tokens[2]);
+        movie.vote_count = parseNumber<int>(tokens[3]);
         movie.status = tokens[4];
         movie.release_date = tokens[5];
-        movie.revenue = stoll(tokens[6]);
-        movie.runtime = stoi(tokens[7]);
+        movie.revenue = parseNumber<long long>(tokens[6]);
+        movie.runtime = parseNumber<int>(tokens[7]);
         movie.adult = (tokens[8] == "False" || tokens[8] == "0");
-        movie.budget = stoll(tokens[10]);
+        movie.budget = parseNumber<long long>(tokens[10]);
         movie.original_language = tokens[13];
         movie.original_title = tokens[14];
         if (!tokens[15].empty())
             movie.overview = tokens[15];
-        if (!tokens[16].empty())
-        {
-            movie.popularity = stof(tokens[16]);
-        }
+        movie.popularity = parseNumber<float>(tokens[16]);
         if (!tokens[18].empty())
             movie.tagline = tokens[18];
 
@@ -188,41 +196,49 @@ vector<Movie> parseCSV(const string &filename, vector<bool> &remove_quotes)
     return movies;
 }
 
-// Function to merge two sorted vectors of movies based on popularity
-vector<Movie> merge(vector<Movie>& left, vector<Movie>& right) {
-    vector<Movie> merged;
-    int i = 0, j = 0;
-    while (i < left.size() && j < right.size()) {
-        if (left[i].popularity >= right[j].popularity) {
-            merged.push_back(left[i]);
-            i++;
-        } else {
-            merged.push_back(right[j]);
-            j++;
-        }
-    }
-    while (i < left.size()) {
-        merged.push_back(left[i]);
-        i++;
+// Sort record holding a movie's popularity and its index in the movies vector
+struct PopularityKey
+{
+    float popularity;
+    size_t index;
+};
+
+// Function to sort movies by popularity, highest first. Only the 16-byte keys are
+// merged, the movies stay where they are and the sorted indices are returned
+vector<size_t> mergeSort(const vector<Movie> &movies)
+{
+    size_t n = movies.size();
+    vector<PopularityKey> keys(n), scratch(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        keys[i] = {movies[i].popularity, i};
     }
-    while (j < right.size()) {
-        merged.push_back(right[j]);
-        j++;
+    for (size_t width = 1; width < n; width *= 2)
+    {
+        for (size_t left = 0; left < n; left += 2 * width)
+        {
+            size_t mid = min(left + width, n), right = min(left + 2 * width, n);
+            size_t i = left, j = mid, k = left;
+            while (i < mid && j < right)
+            {
+                if (keys[i].popularity >= keys[j].popularity)
+                    scratch[k++] = keys[i++];
+                else
+                    scratch[k++] = keys[j++];
+            }
+            while (i < mid)
+                scratch[k++] = keys[i++];
+            while (j < right)
+                scratch[k++] = keys[j++];
+        }
+        keys.swap(scratch);
     }
-    return merged;
-}
-
-// Function to perform merge sort on vector of movies based on popularity
-vector<Movie> mergeSort(vector<Movie>& movies) {
-    if (movies.size() <= 1) {
-        return movies;
+    vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        order[i] = keys[i].index;
     }
-    int mid = movies.size() / 2;
-    vector<Movie> left(movies.begin(), movies.begin() + mid);
-    vector<Movie> right(movies.begin() + mid, movies.end());
-    left = mergeSort(left);
-    right = mergeSort(right);
-    return merge(left, right);
+    return order;
 }
 
 void languageDistribution(const vector<Movie>& movies) {
@@ -302,15 +318,16 @@ int main()
     vector<Movie> movies = parseCSV("animated_movies.csv", remove_quotes);
 
     // Sort movies by popularity using merge sort
-    movies = mergeSort(movies);
+    vector<size_t> order = mergeSort(movies);
 
     // Print the top 5 movie titles with highest popularity
     cout << "Top 10 Movie Titles with Highest Popularity:\n";
     int count = 0;
-    for (const Movie &movie : movies)
+    for (size_t index : order)
     {
         if (count >= 10)
             break;
+        const Movie &movie = movies[index];
         cout << movie.title << " - Popularity: " << movie.popularity << endl;
         count++;
     }
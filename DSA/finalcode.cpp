@@ -1,1069 +1,4458 @@
+// Build: g++ -std=c++17 -O2 -pthread finalcode.cpp -o finalcode
+// Run:   ./finalcode [--csv <file>] [--threads <count>] [--snapshot <file> | --no-snapshot] [--correlation-matrix] [--simd scalar|sse2|avx2|avx512] [--state <file>] [--append <file>] [--stream [--stream-batch <MB>]] [--serve <socket> [--workers <count>]]
+//         [--generate <rows> <file> [--seed <n>]] [--bench [--bench-repeat <n>] [--bench-output <file>]] [--profile <file>|-]
+//         [--reports companies,countries,genres,years,correlations,languages,runtime,words,top]
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <string_view>
+#include <iomanip>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <iterator>
+#include <memory>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <cerrno>
+#include <chrono>
+#include <random>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <atomic>
+#include <ctime>
+#include <new>
+#include <functional>
+#include <array>
+#include <type_traits>
 
 using namespace std;
 
-class Movie
+// Instrumentation. With --profile every stage of the run records its wall time, CPU time, growth of the
+// peak resident set and the allocations made through operator new. Off, a stage costs one flag test and an
+// allocation one relaxed atomic load
+atomic<bool> count_allocations(false);
+atomic<uint64_t> allocation_count(0);
+atomic<uint64_t> allocation_bytes(0);
+
+void *operator new(size_t size)
 {
-public:
-    string title;
-    float vote_average;
-    int vote_count;
-    string status;
-    string release_date;
-    long long revenue; // Change type to long long
-    int runtime;
-    bool adult;
-    long long budget; // Change type to long long
-    string original_language;
-    string original_title;
-    string overview;
-    float popularity;
-    string tagline;
-    vector<string> genres;
-    vector<string> production_companies;
-    vector<string> production_countries;
-    vector<string> spoken_languages;
-};
+    if (count_allocations.load(memory_order_relaxed))
+    {
+        allocation_count.fetch_add(1, memory_order_relaxed);
+        allocation_bytes.fetch_add(size, memory_order_relaxed);
+    }
+    void *memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
 
-// Structure to store title words and their frequency
-struct WordFrequency
+// Kept out of line, inlined into a caller GCC would warn that free() does not match the new expression
+__attribute__((noinline)) void operator delete(void *memory) noexcept
 {
-    string word;
-    int frequency;
-};
+    free(memory);
+}
 
-struct CorrelationResult
+__attribute__((noinline)) void operator delete(void *memory, size_t) noexcept
 {
-    double correlation_coefficient;
-    double sum_x;
-    double sum_y;
-    double sum_xy;
-    double sum_x2;
-    double sum_y2;
-    double denominator;
-    double slope;
-    double intercept;
-};
+    free(memory);
+}
 
-// Struct to hold production company information
-struct CompanyInfo
+// Stages the profiler tells apart. Several places can record the same stage, their figures are added up
+enum ProfileStage
 {
-    string name;
-    long long totalRevenue;
-    vector<string> producedCountries;
+    STAGE_PARSE,
+    STAGE_COMPANIES,
+    STAGE_COUNTRY_QUERIES,
+    STAGE_GENRE_YEAR_COUNTS,
+    STAGE_LANGUAGE_COUNTS,
+    STAGE_CORRELATIONS,
+    STAGE_RUNTIME_HISTOGRAM,
+    STAGE_TITLE_INDEX,
+    STAGE_WORD_COUNTS,
+    STAGE_SORTS,
+    STAGE_MERGE_STATE,
+    STAGE_STATE_IO,
+    STAGE_PRINT,
+    PROFILE_STAGES
 };
 
-// Function to remove double quotes from the start and end of a string
-string removeQuotes(const string &str)
-{
-    string cleaned_str = str;
+const char *const PROFILE_STAGE_NAMES[PROFILE_STAGES] = {"parse", "processCompanyInfo", "country_queries", "genre_year_counts",
+                                                         "language_counts", "correlations", "runtime_histogram", "title_index",
+                                                         "word_counts", "sorts", "merge_state", "state_io", "print"};
 
-    // Remove leading and trailing quotes if present
-    if (!cleaned_str.empty())
+// Collects the figures of the stages. Times and allocations of repeated stages are added up; the peak RSS
+// is a high-water mark, so a stage reports the highest mark at its end and its largest growth in one call
+class StageProfiler
+{
+public:
+    // Process-wide counters at one moment
+    struct Sample
     {
-        if (cleaned_str.front() == '"' && cleaned_str.back() == '"')
-        {
-            cleaned_str = cleaned_str.substr(1, cleaned_str.size() - 2);
-        }
+        double wall = 0;
+        double cpu = 0;
+        long peak_rss_kb = 0;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    void enable()
+    {
+        enabled_ = true;
+        count_allocations = true;
+        start_ = sample();
     }
 
-    return cleaned_str;
-}
+    bool enabled() const { return enabled_; }
 
-// Function to remove leading and trailing spaces from a string
-string trim(const string &str)
-{
-    size_t start = str.find_first_not_of(" \t\n\r\f\v");
-    size_t end = str.find_last_not_of(" \t\n\r\f\v");
-    if (start == string::npos || end == string::npos)
+    Sample sample() const
     {
-        return "";
+        Sample now;
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        now.wall = time.tv_sec + time.tv_nsec * 1e-9;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+        now.cpu = time.tv_sec + time.tv_nsec * 1e-9;
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        now.peak_rss_kb = usage.ru_maxrss;
+        now.allocations = allocation_count.load(memory_order_relaxed);
+        now.bytes = allocation_bytes.load(memory_order_relaxed);
+        return now;
     }
-    return str.substr(start, end - start + 1);
-}
 
-// Function to split a string by a delimiter and return tokens as vector
-vector<string> split_strings(const string &line, char delimiter, const vector<bool> &remove_quotes)
-{
-    vector<string> tokens;
-    stringstream ss(line);
-    string token;
-    size_t index = 0;
-    bool in_quotes = false; // Flag to track if currently inside quoted text
-    while (getline(ss, token, delimiter))
+    // Function to add the figures between start and now to a stage
+    void record(ProfileStage id, const Sample &start)
     {
-        // Check if removal of quotes is required for this token
-        if (!remove_quotes.empty() && index < remove_quotes.size() && remove_quotes[index])
+        Sample end = sample();
+        lock_guard<mutex> guard(lock_);
+        Stage &stage = stages_[id];
+        if (stage.calls == 0)
         {
-            token = removeQuotes(token);
+            order_.push_back(id);
         }
+        stage.calls++;
+        stage.wall += end.wall - start.wall;
+        stage.cpu += end.cpu - start.cpu;
+        stage.allocations += end.allocations - start.allocations;
+        stage.bytes += end.bytes - start.bytes;
+        stage.peak_rss_kb = max(stage.peak_rss_kb, end.peak_rss_kb);
+        stage.rss_growth_kb = max(stage.rss_growth_kb, end.peak_rss_kb - start.peak_rss_kb);
+    }
 
-        // If inside quoted text, continue reading until ending quote is found
-        while (token.front() == '"' && !in_quotes)
+    // Function to write the stages in order of first completion and the totals of the whole run as JSON.
+    // Stages can nest, the figures of a stage include those of the stages inside it
+    void write(ostream &out) const
+    {
+        Sample end = sample();
+        auto figures = [&](const Stage &stage)
         {
-            // Check if token ends with double quote
-            if (token.back() == '"')
-            {
-                // Remove double quotes from token
-                token.erase(token.begin());
-                token.pop_back();
-                break;
-            }
-            else
-            {
-                // Read next token and append to current token
-                string next_token;
-                if (!getline(ss, next_token, delimiter))
-                {
-                    cerr << "Error: Ending quote not found for token: " << token << endl;
-                    break;
-                }
-                token += delimiter + next_token;
-            }
-        }
-
-        // Check if current token starts a quoted text
-        if (token.front() == '"' && !in_quotes)
+            out << "\"wall_s\": " << stage.wall << ", \"cpu_s\": " << stage.cpu << ", \"peak_rss_kb\": " << stage.peak_rss_kb
+                << ", \"peak_rss_growth_kb\": " << stage.rss_growth_kb << ", \"allocations\": " << stage.allocations
+                << ", \"allocated_bytes\": " << stage.bytes;
+        };
+        Stage total = {1, end.wall - start_.wall, end.cpu - start_.cpu, end.allocations - start_.allocations, end.bytes - start_.bytes,
+                       end.peak_rss_kb, end.peak_rss_kb - start_.peak_rss_kb};
+        out << "{\n  \"total\": {";
+        figures(total);
+        out << "},\n  \"stages\": [\n";
+        for (size_t s = 0; s < order_.size(); s++)
         {
-            in_quotes = true;
+            const Stage &stage = stages_[order_[s]];
+            out << "    {\"name\": \"" << PROFILE_STAGE_NAMES[order_[s]] << "\", \"calls\": " << stage.calls << ", ";
+            figures(stage);
+            out << "}" << (s + 1 < order_.size() ? "," : "") << "\n";
         }
+        out << "  ]\n}" << endl;
+    }
 
-        // Check if current token ends the quoted text
-        if (token.back() == '"' && in_quotes)
-        {
-            in_quotes = false;
-        }
+private:
+    struct Stage
+    {
+        uint64_t calls = 0;
+        double wall = 0;
+        double cpu = 0;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        long peak_rss_kb = 0;   // Highest RSS high-water mark at the end of a call
+        long rss_growth_kb = 0; // Largest rise of the high-water mark during one call
+    };
+
+    bool enabled_ = false;
+    Sample start_;
+    mutex lock_;
+    Stage stages_[PROFILE_STAGES];
+    vector<ProfileStage> order_;
+};
 
-        tokens.push_back(token);
-        index++;
-    }
-    return tokens;
-}
+StageProfiler profiler;
 
-// Function to split a string by a delimiter and return non-empty tokens as vector
-vector<string> split(const string &line, char delimiter)
+// Records the block it lives in, or the part up to end(), as one call of a profiler stage
+class ProfileScope
 {
-    vector<string> tokens;
-    stringstream ss(line);
-    string token;
-    while (getline(ss, token, delimiter))
+public:
+    explicit ProfileScope(ProfileStage stage) : stage_(stage), active_(profiler.enabled())
     {
-        if (!token.empty())
+        if (active_)
         {
-            tokens.push_back(token);
+            start_ = profiler.sample();
         }
     }
-    return tokens;
-}
-
-// Function to parse the CSV file and store contents
-vector<Movie> parseCSV(const string &filename, vector<bool> &remove_quotes)
-{
-    vector<Movie> movies;
 
-    ifstream file(filename);
-    if (!file.is_open())
-    {
-        cerr << "Error opening file: " << filename << endl;
-        return movies;
-    }
+    ~ProfileScope() { end(); }
 
-    string line;
-    // Skip header line
-    getline(file, line);
-    while (getline(file, line))
-    {
-        Movie movie;
-        vector<string> tokens = split_strings(line, ',', remove_quotes);
-
-        // Fill movie struct with tokens
-        movie.title = tokens[1];
-        movie.vote_average = stof(tokens[2]); // Convert to float
-        movie.vote_count = stoi(tokens[3]);   // Convert to float
-        movie.status = tokens[4];
-        movie.release_date = tokens[5];
-        movie.revenue = stoll(tokens[6]); // Convert to long long
-        movie.runtime = stoi(tokens[7]);
-        movie.adult = (tokens[8] == "False" || tokens[8] == "0");
-        movie.budget = stoll(tokens[10]); // Convert to long long
-        movie.original_language = tokens[13];
-        movie.original_title = tokens[14];
-        if (!tokens[15].empty())
-            movie.overview = tokens[15];
-        if (!tokens[16].empty())
-        {
-
-            movie.popularity = stof(tokens[16]); // Convert to float
-        }
-        if (!tokens[18].empty())
-            movie.tagline = tokens[18];
-
-        // Parse genres
-        vector<string> genres = split(tokens[19], '|');
-        movie.genres = move(genres);
-
-        // Parse production companies
-        vector<string> production_companies = split(tokens[20], '|');
-        if (!tokens[20].empty())
-            movie.production_companies = move(production_companies);
-
-        // Parse production countries
-        vector<string> production_countries = split(tokens[21], '|');
-        if (!tokens[21].empty())
-            movie.production_countries = move(production_countries);
-
-        // Parse spoken languages
-        vector<string> spoken_languages = split(tokens[22], '|');
-        if (!tokens[22].empty())
-            movie.spoken_languages = move(spoken_languages);
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
 
-        movies.push_back(move(movie));
+    void end()
+    {
+        if (active_)
+        {
+            profiler.record(stage_, start_);
+            active_ = false;
+        }
     }
 
-    file.close();
-
-    return movies;
-}
+private:
+    ProfileStage stage_;
+    bool active_;
+    StageProfiler::Sample start_;
+};
 
-// Function to count the frequency of all genres mentioned in the movies
-void mergeString(vector<string> &arr, int left, int mid, int right)
+// Fork-join pool the parallel stages run on. Every worker owns a deque of tasks: a thread queues the tasks
+// it forks on its own deque and takes them back newest first, an idle thread steals the oldest task of
+// another deque, which is the largest piece of a divide and conquer split. A thread with nothing to run
+// sleeps until a task is queued or, in wait(), until the group it waits for is done
+class WorkStealingPool
 {
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
+public:
+    // Unfinished tasks forked by one step, wait() returns when it drops to zero
+    struct TaskGroup
+    {
+        atomic<size_t> pending{0};
+    };
 
-    vector<string> L(n1), R(n2);
+    // The calling thread takes part in wait(), so a pool of n threads starts n - 1 workers
+    explicit WorkStealingPool(unsigned threads) : queues_(max(1u, threads))
+    {
+        for (size_t i = 1; i < queues_.size(); i++)
+        {
+            workers_.emplace_back([this, i]()
+                                  { work(i); });
+        }
+    }
 
-    for (int i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (int j = 0; j < n2; j++)
-        R[j] = arr[mid + 1 + j];
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
 
-    int i = 0, j = 0, k = left;
-    while (i < n1 && j < n2)
+    ~WorkStealingPool()
     {
-        if (L[i] <= R[j])
         {
-            arr[k] = L[i];
-            i++;
+            lock_guard<mutex> lock(sleep_);
+            stop_ = true;
         }
-        else
+        wake_.notify_all();
+        for (thread &worker : workers_)
         {
-            arr[k] = R[j];
-            j++;
+            worker.join();
         }
-        k++;
     }
 
-    while (i < n1)
+    size_t size() const
     {
-        arr[k] = L[i];
-        i++;
-        k++;
+        return queues_.size();
     }
 
-    while (j < n2)
+    // Function to queue a task of a group where an idle thread can steal it
+    void spawn(TaskGroup &group, function<void()> task)
     {
-        arr[k] = R[j];
-        j++;
-        k++;
+        group.pending++;
+        Queue &queue = queues_[self()];
+        {
+            lock_guard<mutex> lock(queue.lock);
+            queue.tasks.push_back([this, &group, task = move(task)]()
+                                  {
+                task();
+                finish(group); });
+            queued_++;
+        }
+        lock_guard<mutex> lock(sleep_);
+        wake_.notify_all();
     }
-}
 
-void mergeSortString(vector<string> &arr, int left, int right)
-{
-    if (left >= right)
+    // Function to wait for the tasks of a group, running queued tasks meanwhile and sleeping when there are none
+    void wait(TaskGroup &group)
     {
-        return;
+        size_t index = self();
+        while (group.pending > 0)
+        {
+            if (!runOne(index))
+            {
+                unique_lock<mutex> lock(sleep_);
+                wake_.wait(lock, [&]()
+                           { return group.pending == 0 || queued_ > 0; });
+            }
+        }
     }
 
-    int mid = left + (right - left) / 2;
-    mergeSortString(arr, left, mid);
-    mergeSortString(arr, mid + 1, right);
-    mergeString(arr, left, mid, right);
-}
+    // Function to run task(0) to task(count - 1) on the pool, task(0) on the calling thread, and return when all are done
+    template <typename Task>
+    void run(size_t count, const Task &task)
+    {
+        TaskGroup group;
+        for (size_t i = 1; i < count; i++)
+        {
+            spawn(group, [&task, i]()
+                  { task(i); });
+        }
+        if (count > 0)
+        {
+            task(0);
+        }
+        wait(group);
+    }
 
-// Merge function for Merge Sort
-void mergeInt(vector<pair<int, vector<WordFrequency>>> &arr, int low, int mid, int high)
-{
-    int n1 = mid - low + 1;
-    int n2 = high - mid;
+private:
+    struct Queue
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
 
-    // Create temporary arrays
-    vector<pair<int, vector<WordFrequency>>> left(n1);
-    vector<pair<int, vector<WordFrequency>>> right(n2);
+    // Pool and deque of the calling thread, if it is a worker
+    static thread_local const WorkStealingPool *current_pool;
+    static thread_local size_t current_index;
 
-    // Copy data to temporary arrays left[] and right[]
-    for (int i = 0; i < n1; ++i)
-        left[i] = arr[low + i];
-    for (int j = 0; j < n2; ++j)
-        right[j] = arr[mid + 1 + j];
+    // Function to find the deque of the calling thread: workers own 1 and up, every other thread shares deque 0
+    size_t self() const
+    {
+        return current_pool == this ? current_index : 0;
+    }
 
-    // Merge the temporary arrays back into arr[low..high]
-    int i = 0;   // Initial index of first subarray
-    int j = 0;   // Initial index of second subarray
-    int k = low; // Initial index of merged subarray
+    // Function to count a task of a group as done and wake the threads waiting for the group.
+    // The lock orders the wake-up after a waiter's check, so the wake-up cannot be missed
+    void finish(TaskGroup &group)
+    {
+        if (--group.pending == 0)
+        {
+            lock_guard<mutex> lock(sleep_);
+            wake_.notify_all();
+        }
+    }
 
-    while (i < n1 && j < n2)
+    // Function to take the newest or the oldest task off a deque. queued_ changes under the deque's lock on
+    // both sides, so a task is always counted before it can be taken and the count never drops below zero
+    bool take(size_t index, bool newest, function<void()> &task)
     {
-        if (left[i].first >= right[j].first)
+        Queue &queue = queues_[index];
+        lock_guard<mutex> lock(queue.lock);
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+        if (newest)
         {
-            arr[k] = left[i];
-            ++i;
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
         }
         else
         {
-            arr[k] = right[j];
-            ++j;
+            task = move(queue.tasks.front());
+            queue.tasks.pop_front();
         }
-        ++k;
+        queued_--;
+        return true;
     }
 
-    // Copy the remaining elements of left[], if any
-    while (i < n1)
+    // Function to run one task, from the thread's own deque first and stolen otherwise
+    bool runOne(size_t index)
     {
-        arr[k] = left[i];
-        ++i;
-        ++k;
+        function<void()> task;
+        bool found = take(index, true, task);
+        for (size_t i = 1; !found && i < queues_.size(); i++)
+        {
+            found = take((index + i) % queues_.size(), false, task);
+        }
+        if (!found)
+        {
+            return false;
+        }
+        task();
+        return true;
     }
 
-    // Copy the remaining elements of right[], if any
-    while (j < n2)
+    // Function run by every worker: run tasks while there are any, sleep otherwise, until the pool is destroyed
+    void work(size_t index)
     {
-        arr[k] = right[j];
-        ++j;
-        ++k;
+        current_pool = this;
+        current_index = index;
+        while (true)
+        {
+            if (runOne(index))
+            {
+                continue;
+            }
+            unique_lock<mutex> lock(sleep_);
+            wake_.wait(lock, [this]()
+                       { return stop_ || queued_ > 0; });
+            if (stop_)
+            {
+                return;
+            }
+        }
     }
-}
-
-// Merge Sort function
-void mergeSortInt(vector<pair<int, vector<WordFrequency>>> &arr, int low, int high)
-{
-    if (low < high)
-    {
-        // Find the middle point
-        int mid = low + (high - low) / 2;
 
-        // Sort first and second halves
-        mergeSortInt(arr, low, mid);
-        mergeSortInt(arr, mid + 1, high);
+    vector<Queue> queues_;
+    vector<thread> workers_;
+    bool stop_ = false; // Guarded by sleep_
+    atomic<size_t> queued_{0}; // Tasks waiting in all the deques
+    mutex sleep_;
+    condition_variable wake_;
+};
 
-        // Merge the sorted halves
-        mergeInt(arr, low, mid, high);
-    }
-}
+thread_local const WorkStealingPool *WorkStealingPool::current_pool = nullptr;
+thread_local size_t WorkStealingPool::current_index = 0;
 
-// Function to merge two sorted vectors of movies based on revenue
-vector<Movie> mergeMovie(vector<Movie> &left, vector<Movie> &right, string column)
+// Bump allocator for the text and lists of rows loaded one Movie at a time. Memory is handed out from
+// large blocks that are only released together when the arena goes away, so loading a row makes no heap
+// allocation of its own and a whole dataset is torn down with one free per block
+class Arena
 {
-    vector<Movie> merged;
-    int i = 0, j = 0;
-    bool compareLeft = (column == "revenue");
-    while (i < left.size() && j < right.size())
+public:
+    static const size_t BLOCK_SIZE = 1 << 20;
+
+    Arena() = default;
+    Arena(Arena &&) = default;
+    Arena &operator=(Arena &&) = default;
+
+    // Function to reserve bytes at the given alignment, a request larger than a block gets a block of its own
+    void *allocate(size_t bytes, size_t alignment)
     {
-        if ((compareLeft && left[i].revenue >= right[j].revenue) || (!compareLeft && left[i].popularity >= right[j].popularity))
-        {
-            merged.push_back(left[i]);
-            i++;
-        }
-        else
+        size_t padding = next_ == nullptr ? 0 : (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
+        if (next_ == nullptr || padding + bytes > left_)
         {
-            merged.push_back(right[j]);
-            j++;
+            size_t size = max(BLOCK_SIZE, bytes + alignment);
+            blocks_.emplace_back(new char[size]);
+            next_ = blocks_.back().get();
+            left_ = size;
+            padding = (alignment - reinterpret_cast<uintptr_t>(next_) % alignment) % alignment;
         }
+        char *memory = next_ + padding;
+        next_ += padding + bytes;
+        left_ -= padding + bytes;
+        return memory;
     }
-    // Copy remaining elements from left and right vectors
-    while (i < left.size())
+
+    // Function to copy text into the arena
+    string_view copy(string_view text)
     {
-        merged.push_back(left[i]);
-        i++;
+        if (text.empty())
+        {
+            return string_view();
+        }
+        char *memory = static_cast<char *>(allocate(text.size(), 1));
+        memcpy(memory, text.data(), text.size());
+        return string_view(memory, text.size());
     }
-    while (j < right.size())
+
+    // Function to take over the blocks of other, views into them stay valid
+    void adopt(Arena &&other)
     {
-        merged.push_back(right[j]);
-        j++;
+        for (unique_ptr<char[]> &block : other.blocks_)
+        {
+            blocks_.push_back(move(block));
+        }
+        other.blocks_.clear();
+        other.next_ = nullptr;
+        other.left_ = 0;
     }
-    return merged;
-}
 
-// Function to perform merge sort on vector of movies based on revenue
-vector<Movie> mergeSortMovie(vector<Movie> &movies, string column)
+private:
+    vector<unique_ptr<char[]>> blocks_;
+    char *next_ = nullptr; // Free space left in the block allocated last
+    size_t left_ = 0;
+};
+
+// List of texts kept in an arena, such as the genres of a movie
+class TextList
 {
-    if (movies.size() <= 1)
-    {
-        return movies;
-    }
-    int mid = movies.size() / 2;
-    vector<Movie> left(movies.begin(), movies.begin() + mid);
-    vector<Movie> right(movies.begin() + mid, movies.end());
-    left = mergeSortMovie(left, column);
-    right = mergeSortMovie(right, column);
-    return mergeMovie(left, right, column);
-}
+public:
+    TextList() = default;
+    TextList(const string_view *items, uint32_t count) : items_(items), count_(count) {}
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    string_view operator[](size_t i) const { return items_[i]; }
+    const string_view *begin() const { return items_; }
+    const string_view *end() const { return items_ + count_; }
+
+private:
+    const string_view *items_ = nullptr;
+    uint32_t count_ = 0;
+};
 
-// Function to merge two sorted pairs based on a numeric value
-template <typename T>
-void mergePairs(vector<pair<string, T>> &arr, int left, int mid, int right)
+// One movie loaded as a row. Its text and lists point into the arena of the MovieRows holding it
+class Movie
 {
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
+public:
+    string_view title;
+    float vote_average;
+    int vote_count;
+    string_view status;
+    string_view release_date;
+    long long revenue; // Change type to long long
+    int runtime;
+    bool adult;
+    long long budget; // Change type to long long
+    string_view original_language;
+    string_view original_title;
+    string_view overview;
+    float popularity = 0;
+    string_view tagline;
+    TextList genres;
+    TextList production_companies;
+    TextList production_countries;
+    TextList spoken_languages;
+};
 
-    vector<pair<string, T>> L(n1), R(n2);
+// Movies loaded row by row together with the arena owning their text and lists
+class MovieRows
+{
+public:
+    vector<Movie> movies;
+    Arena arena;
 
-    for (int i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (int j = 0; j < n2; j++)
-        R[j] = arr[mid + 1 + j];
+    size_t size() const { return movies.size(); }
+    const Movie &operator[](size_t i) const { return movies[i]; }
+    vector<Movie>::const_iterator begin() const { return movies.begin(); }
+    vector<Movie>::const_iterator end() const { return movies.end(); }
+};
 
-    int i = 0, j = 0, k = left;
-    while (i < n1 && j < n2)
+// Read-only memory mapping of a whole file, released when the object goes out of scope
+class MappedFile
+{
+public:
+    // advice tells the kernel how the mapping will be read, see madvise(2)
+    explicit MappedFile(const string &filename, int advice = MADV_SEQUENTIAL)
     {
-        if (L[i].second >= R[j].second)
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
         {
-            arr[k] = L[i];
-            i++;
+            return;
         }
-        else
+        struct stat info;
+        if (fstat(fd, &info) == 0)
         {
-            arr[k] = R[j];
-            j++;
+            size_ = static_cast<size_t>(info.st_size);
+            opened_ = true;
+            if (size_ > 0)
+            {
+                void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (addr == MAP_FAILED)
+                {
+                    size_ = 0;
+                    opened_ = false;
+                }
+                else
+                {
+                    data_ = static_cast<const char *>(addr);
+                    madvise(addr, size_, advice);
+                }
+            }
         }
-        k++;
+        close(fd);
     }
 
-    while (i < n1)
+    ~MappedFile()
     {
-        arr[k] = L[i];
-        i++;
-        k++;
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<char *>(data_), size_);
+        }
     }
 
-    while (j < n2)
-    {
-        arr[k] = R[j];
-        j++;
-        k++;
-    }
-}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
 
-// Function to perform merge sort on pairs based on a numeric value
-template <typename T>
-void mergeSortPairs(vector<pair<string, T>> &arr, int left, int right)
-{
-    if (left >= right)
+    bool is_open() const { return opened_; }
+    string_view view() const { return string_view(data_, size_); }
+
+    // Function to drop the pages of [begin, end) from memory once they have been read; reading them
+    // again faults them back in from the file
+    void release(size_t begin, size_t end)
     {
-        return;
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        begin = (begin + page - 1) / page * page;
+        end = min(end, size_) / page * page;
+        if (data_ != nullptr && begin < end)
+        {
+            madvise(const_cast<char *>(data_) + begin, end - begin, MADV_DONTNEED);
+        }
     }
 
-    int mid = left + (right - left) / 2;
-    mergeSortPairs(arr, left, mid);
-    mergeSortPairs(arr, mid + 1, right);
-    mergePairs(arr, left, mid, right);
-}
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool opened_ = false;
+};
 
-// Function to merge two sorted vectors of companies based on total revenue
-vector<CompanyInfo> mergeCompanies(vector<CompanyInfo> &left, vector<CompanyInfo> &right)
+// Column of fixed-width values. It either owns its storage or borrows a read-only range, for example
+// from a mapped snapshot file; the first modification of a borrowed column copies it into owned storage
+template <typename T>
+class Column
 {
-    vector<CompanyInfo> merged;
-    int i = 0, j = 0;
-    while (i < left.size() && j < right.size())
+public:
+    using value_type = T;
+
+    Column() = default;
+    Column(initializer_list<T> values) : owned_(values) { sync(); }
+    Column(const Column &other) : owned_(other.owned_), borrowed_(other.borrowed_)
     {
-        if (left[i].totalRevenue >= right[j].totalRevenue)
+        if (borrowed_)
         {
-            merged.push_back(left[i]);
-            i++;
+            data_ = other.data_;
+            size_ = other.size_;
         }
         else
         {
-            merged.push_back(right[j]);
-            j++;
+            sync();
         }
     }
-    while (i < left.size())
+    Column(Column &&other) noexcept : owned_(move(other.owned_)), data_(other.data_), size_(other.size_), borrowed_(other.borrowed_)
     {
-        merged.push_back(left[i]);
-        i++;
+        if (!borrowed_)
+        {
+            sync();
+        }
+        other.borrowed_ = false;
+        other.sync();
     }
-    while (j < right.size())
+    Column &operator=(Column other) noexcept
     {
-        merged.push_back(right[j]);
-        j++;
+        swap(owned_, other.owned_);
+        swap(data_, other.data_);
+        swap(size_, other.size_);
+        swap(borrowed_, other.borrowed_);
+        if (!borrowed_)
+        {
+            sync();
+        }
+        return *this;
     }
-    return merged;
-}
 
-// Function to perform merge sort on vector of companies based on total revenue
-vector<CompanyInfo> mergeSortCompanies(vector<CompanyInfo> &companies)
-{
-    if (companies.size() <= 1)
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T *data() const { return data_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+    const T &operator[](size_t i) const { return data_[i]; }
+    const T &back() const { return data_[size_ - 1]; }
+
+    void push_back(const T &value)
     {
-        return companies;
+        own();
+        owned_.push_back(value);
+        sync();
     }
-    int mid = companies.size() / 2;
-    vector<CompanyInfo> left(companies.begin(), companies.begin() + mid);
-    vector<CompanyInfo> right(companies.begin() + mid, companies.end());
-    left = mergeSortCompanies(left);
-    right = mergeSortCompanies(right);
-    return mergeCompanies(left, right);
-}
 
-// Merge function for Merge Sort - For the sorting the frequencies of words
-void merge(vector<WordFrequency> &arr, int low, int mid, int high)
-{
-    int n1 = mid - low + 1;
-    int n2 = high - mid;
+    void append(const T *first, const T *last)
+    {
+        own();
+        owned_.insert(owned_.end(), first, last);
+        sync();
+    }
 
-    // Create temporary arrays
-    vector<WordFrequency> left(n1);
-    vector<WordFrequency> right(n2);
+    void reserve(size_t capacity)
+    {
+        own();
+        owned_.reserve(capacity);
+        sync();
+    }
 
-    // Copy data to temporary arrays left[] and right[]
-    for (int i = 0; i < n1; ++i)
-        left[i] = arr[low + i];
-    for (int j = 0; j < n2; ++j)
-        right[j] = arr[mid + 1 + j];
+    void set(size_t i, const T &value)
+    {
+        own();
+        owned_[i] = value;
+        sync();
+    }
 
-    // Merge the temporary arrays back into arr[low..high]
-    int i = 0;   // Initial index of first subarray
-    int j = 0;   // Initial index of second subarray
-    int k = low; // Initial index of merged subarray
+    // Function to point the column at size values that stay valid for as long as the column is used
+    void borrow(const T *data, size_t size)
+    {
+        vector<T>().swap(owned_);
+        data_ = data;
+        size_ = size;
+        borrowed_ = true;
+    }
 
-    while (i < n1 && j < n2)
+private:
+    void own()
     {
-        if (left[i].frequency >= right[j].frequency)
-        {
-            arr[k] = left[i];
-            ++i;
-        }
-        else
+        if (borrowed_)
         {
-            arr[k] = right[j];
-            ++j;
+            owned_.assign(data_, data_ + size_);
+            borrowed_ = false;
         }
-        ++k;
     }
 
-    // Copy the remaining elements of left[], if any
-    while (i < n1)
+    void sync()
     {
-        arr[k] = left[i];
-        ++i;
-        ++k;
+        data_ = owned_.data();
+        size_ = owned_.size();
     }
 
-    // Copy the remaining elements of right[], if any
-    while (j < n2)
-    {
-        arr[k] = right[j];
-        ++j;
-        ++k;
-    }
-}
+    vector<T> owned_;
+    const T *data_ = nullptr;
+    size_t size_ = 0;
+    bool borrowed_ = false;
+};
 
-// Merge Sort function - For the sorting the frequencies of words
-void mergeSort(vector<WordFrequency> &arr, int low, int high)
+// Bitmap with one bit per row, set when the field of that row held a well-formed value. The words live in a
+// Column so a snapshot maps them like the values they describe
+class ValidityBitmap
 {
-    if (low < high)
-    {
-        // Find the middle point
-        int mid = low + (high - low) / 2;
+public:
+    Column<uint64_t> words;
 
-        // Sort first and second halves
-        mergeSort(arr, low, mid);
-        mergeSort(arr, mid + 1, high);
+    size_t size() const { return size_; }
+    bool valid(size_t row) const { return (words[row / 64] >> (row % 64)) & 1; }
 
-        // Merge the sorted halves
-        merge(arr, low, mid, high);
+    void push_back(bool valid)
+    {
+        appendBits(valid ? 1 : 0, 1);
     }
-}
 
-// Binary search to check if a string exists in a sorted vector of strings
-bool binarySearch(const vector<string> &arr, const string &target)
-{
-    int left = 0;
-    int right = arr.size() - 1;
+    // Function to move the bits of another bitmap to the end of this one, a word at a time
+    void append(ValidityBitmap &&other)
+    {
+        for (size_t bit = 0; bit < other.size_; bit += 64)
+        {
+            appendBits(other.words[bit / 64], min<size_t>(64, other.size_ - bit));
+        }
+        other = ValidityBitmap();
+    }
 
-    while (left <= right)
+    // Function to set the number of rows after the words were borrowed from a snapshot
+    void setSize(size_t rows)
     {
-        int mid = left + (right - left) / 2;
+        size_ = rows;
+    }
 
-        // Check if the middle element is the target
-        if (arr[mid] == target)
+    // Function to count the rows whose field was empty or malformed
+    size_t countInvalid() const
+    {
+        size_t valid = 0;
+        for (uint64_t word : words)
         {
-            return true;
+            valid += __builtin_popcountll(word);
         }
-        // If target is greater, ignore left half
-        else if (arr[mid] < target)
+        return size_ - valid;
+    }
+
+private:
+    // Appends the low count bits of bits, the bits above them have to be clear
+    void appendBits(uint64_t bits, size_t count)
+    {
+        size_t shift = size_ % 64;
+        if (shift == 0)
         {
-            left = mid + 1;
+            words.push_back(bits);
         }
-        // If target is smaller, ignore right half
         else
         {
-            right = mid - 1;
+            words.set(words.size() - 1, words.back() | bits << shift);
+            if (shift + count > 64)
+            {
+                words.push_back(bits >> (64 - shift));
+            }
         }
+        size_ += count;
     }
-    // If not found, return false
-    return false;
-}
 
-// Function to insert a string into the bucket at the appropriate position
-void insertSort(vector<string> &bucket, string &val)
+    size_t size_ = 0;
+};
+
+// Column of strings stored back to back, row i spans bytes [offsets[i], offsets[i + 1])
+class StringColumn
 {
-    auto it = bucket.begin();
-    while (it != bucket.end() && *it < val)
+public:
+    Column<char> bytes;
+    Column<uint64_t> offsets = {0};
+
+    size_t size() const { return offsets.size() - 1; }
+
+    string_view operator[](size_t i) const
     {
-        ++it;
+        return string_view(bytes.data() + offsets[i], offsets[i + 1] - offsets[i]);
     }
-    bucket.insert(it, val);
-}
-
-// Bucket sort for lowercase words
-void bucketSort(vector<string> &words)
-{
-    vector<vector<string>> buckets(26); // Assuming only lowercase words
 
-    // Distribute words into buckets based on their first character
-    for (string &word : words)
+    void push_back(string_view value)
     {
-        int bucketIndex = word[0] - 'a';
-        insertSort(buckets[bucketIndex], word);
+        bytes.append(value.data(), value.data() + value.size());
+        offsets.push_back(bytes.size());
     }
 
-    // Concatenate the buckets back into the original array
-    int index = 0;
-    for (auto &bucket : buckets)
+    // Function to move the rows of another column to the end of this one
+    void append(StringColumn &&other)
     {
-        for (string &word : bucket)
+        uint64_t base = bytes.size();
+        bytes.append(other.bytes.begin(), other.bytes.end());
+        for (size_t i = 1; i < other.offsets.size(); i++)
         {
-            words[index++] = word;
+            offsets.push_back(base + other.offsets[i]);
         }
+        other = StringColumn();
     }
-}
+};
 
-// Function to find the country with the highest value based on a numeric property
-template <typename T>
-string findCountryWithHighestProperty(const vector<Movie> &movies, T Movie::*property)
+// Function to hash a byte range eight bytes at a time
+uint64_t hashBytes(string_view data, uint64_t seed = 0)
 {
-    vector<pair<string, T>> countryProperty;
-
-    // Calculate total property for each country
-    for (const Movie &movie : movies)
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+    uint64_t hash = seed ^ (data.size() * multiplier);
+    size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8)
     {
-        for (const string &country : movie.production_countries)
-        {
-            bool found = false;
-            for (pair<string, T> &cp : countryProperty)
-            {
-                if (cp.first == country)
-                {
-                    cp.second += movie.*property;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                countryProperty.emplace_back(country, movie.*property);
-            }
-        }
+        uint64_t word;
+        memcpy(&word, data.data() + i, sizeof(word));
+        hash = (hash ^ word) * multiplier;
+        hash ^= hash >> 29;
     }
+    for (; i < data.size(); i++)
+    {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * multiplier;
+    }
+    hash ^= hash >> 32;
+    return hash;
+}
 
-    // Sort countries based on the property using merge sort
-    mergeSortPairs(countryProperty, 0, countryProperty.size() - 1);
+// Function to hash an integer key, the splitmix64 finalizer
+uint64_t hashKey(uint64_t key)
+{
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
 
-    // Return the country with the highest property
-    return countryProperty[0].first;
+uint64_t hashKey(string_view key)
+{
+    return hashBytes(key);
 }
 
-// Function to find the country with the most number of movies
-string findMostProducingCountry(const vector<Movie> &movies)
+// Open-addressing index from keys to dense positions 0, 1, 2, ... in order of insertion.
+// The keys stay with the caller: find takes the key's hash and a predicate that compares the key stored at a
+// position with the one searched for. Slots are 8 bytes and probed linearly, the table is kept at most half full
+class FlatHashIndex
 {
-    vector<pair<string, int>> countryCount;
+public:
+    size_t size() const { return hashes_.size(); }
 
-    // Count movies for each country
-    for (const Movie &movie : movies)
+    // Function to return the position of the matching key, or -1 if there is none
+    template <typename Equals>
+    int64_t find(uint64_t hash, Equals &&equals) const
     {
-        for (const string &country : movie.production_countries)
+        if (slots_.empty())
         {
-            bool found = false;
-            for (pair<string, int> &cc : countryCount)
+            return -1;
+        }
+        size_t mask = slots_.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots_[i];
+            if (slot.position == 0)
             {
-                if (cc.first == country)
-                {
-                    cc.second++;
-                    found = true;
-                    break;
-                }
+                return -1;
             }
-            if (!found)
+            if (slot.tag == tag && equals(slot.position - 1))
             {
-                countryCount.emplace_back(country, 1);
+                return slot.position - 1;
             }
         }
     }
 
-    // Sort countries based on movie count using merge sort
-    mergeSortPairs(countryCount, 0, countryCount.size() - 1);
-
-    // Return the country with the most number of movies
-    return countryCount[0].first;
-}
-
-vector<CompanyInfo> processCompanyInfo(const vector<Movie> &movies)
-{
-    vector<CompanyInfo> companies;
-
-    for (const Movie &movie : movies)
+    // Function to register the next position under hash, the caller has checked that the key is absent
+    uint32_t insert(uint64_t hash)
     {
-        for (const string &company : movie.production_companies)
+        if ((hashes_.size() + 1) * 2 > slots_.size())
         {
-            bool found = false;
-            for (CompanyInfo &info : companies)
-            {
-                if (info.name == company)
-                {
-                    info.totalRevenue += movie.revenue;
-                    bool countryFound = false;
-                    for (const string &country : movie.production_countries)
-                    {
-                        countryFound = false;
-                        for (const string &producedCountry : info.producedCountries)
-                        {
-                            if (producedCountry == country)
-                            {
-                                countryFound = true;
-                                break;
-                            }
-                        }
-                        if (!countryFound)
-                        {
-                            info.producedCountries.push_back(country);
-                        }
-                    }
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                CompanyInfo companyInfo;
-                companyInfo.name = company;
-                companyInfo.totalRevenue = movie.revenue;
-                companyInfo.producedCountries = movie.production_countries;
-                companies.push_back(companyInfo);
-            }
+            rehash(max<size_t>(16, slots_.size() * 2));
         }
+        uint32_t position = static_cast<uint32_t>(hashes_.size());
+        hashes_.push_back(hash);
+        place(hash, position);
+        return position;
     }
 
-    return companies;
-}
+    void reserve(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity < count * 2)
+        {
+            capacity *= 2;
+        }
+        if (capacity > slots_.size())
+        {
+            rehash(capacity);
+        }
+        hashes_.reserve(count);
+    }
 
-// Overloaded function for correlation calculation with detailed output
-template <typename T1, typename T2>
-CorrelationResult correlation(const vector<T1> &x, const vector<T2> &y)
-{
-    size_t n = x.size(); // Use size_t for consistency and to avoid precision loss
+    void clear()
+    {
+        slots_.clear();
+        hashes_.clear();
+    }
 
-    // Initialize correlation and linear regression details
-    CorrelationResult result;
-    result.sum_x = 0;
-    result.sum_y = 0;
-    result.sum_xy = 0;
-    result.sum_x2 = 0;
-    result.sum_y2 = 0;
-    result.slope = 0;
-    result.intercept = 0;
+private:
+    struct Slot
+    {
+        uint32_t tag = 0;      // High half of the key's hash
+        uint32_t position = 0; // Position plus one, zero marks an empty slot
+    };
 
-    // Check if the sizes of x and y are the same
-    if (n != y.size())
+    void place(uint64_t hash, uint32_t position)
     {
-        cerr << "Error: Vectors x and y must have the same size for correlation calculation." << endl;
-        result.correlation_coefficient = 0.0; // Return 0 for error
-        return result;
+        size_t mask = slots_.size() - 1;
+        size_t i = hash & mask;
+        while (slots_[i].position != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        slots_[i].tag = static_cast<uint32_t>(hash >> 32);
+        slots_[i].position = position + 1;
     }
-    // Calculate sums and products
-    for (size_t i = 0; i < n; ++i)
+
+    void rehash(size_t capacity)
     {
-        result.sum_x += x[i];
-        result.sum_y += y[i];
-        result.sum_xy += x[i] * y[i];
-        result.sum_x2 += x[i] * x[i];
-        result.sum_y2 += y[i] * y[i];
+        slots_.assign(capacity, Slot());
+        for (uint32_t position = 0; position < hashes_.size(); position++)
+        {
+            place(hashes_[position], position);
+        }
     }
 
-    // Calculate correlation coefficient
-    result.denominator = sqrt((n * result.sum_x2 - result.sum_x * result.sum_x) * (n * result.sum_y2 - result.sum_y * result.sum_y));
-    if (result.denominator == 0)
+    vector<Slot> slots_;
+    vector<uint64_t> hashes_; // Hash of the key at every position, used to grow the table
+};
+
+// Aggregate functions for HashAggregator. Each one describes its running state, the state of an empty group,
+// how a value is folded in and what the group reports
+struct CountAggregate
+{
+    using State = long long;
+    static State initial() { return 0; }
+    template <typename V>
+    static void add(State &state, const V &) { state++; }
+    static void merge(State &state, const State &other) { state += other; }
+    static long long result(const State &state) { return state; }
+};
+
+template <typename T>
+struct SumAggregate
+{
+    using State = T;
+    static State initial() { return T(); }
+    static void add(State &state, const T &value) { state += value; }
+    static void merge(State &state, const State &other) { state += other; }
+    static T result(const State &state) { return state; }
+};
+
+template <typename T>
+struct MaxAggregate
+{
+    using State = T;
+    static State initial() { return numeric_limits<T>::lowest(); }
+    static void add(State &state, const T &value) { state = max(state, value); }
+    static void merge(State &state, const State &other) { state = max(state, other); }
+    static T result(const State &state) { return state; }
+};
+
+template <typename T>
+struct MinAggregate
+{
+    using State = T;
+    static State initial() { return numeric_limits<T>::max(); }
+    static void add(State &state, const T &value) { state = min(state, value); }
+    static void merge(State &state, const State &other) { state = min(state, other); }
+    static T result(const State &state) { return state; }
+};
+
+template <typename T>
+struct AvgAggregate
+{
+    struct State
+    {
+        double sum;
+        long long count;
+    };
+    static State initial() { return {0, 0}; }
+    static void add(State &state, const T &value)
     {
-        result.correlation_coefficient = 0.0; // Avoid division by zero
+        state.sum += value;
+        state.count++;
     }
-    else
+    static void merge(State &state, const State &other)
     {
-        result.correlation_coefficient = (n * result.sum_xy - result.sum_x * result.sum_y) / result.denominator;
-        // Calculate linear regression parameters (slope and intercept)
-        result.slope = (n * result.sum_xy - result.sum_x * result.sum_y) / (n * result.sum_x2 - result.sum_x * result.sum_x);
-        result.intercept = (result.sum_y - result.slope * result.sum_x) / n;
+        state.sum += other.sum;
+        state.count += other.count;
     }
+    static double result(const State &state) { return state.count == 0 ? 0 : state.sum / state.count; }
+};
 
-    cout << "Correlation Coefficient: " << result.correlation_coefficient << endl;
-    cout << "Sum of x: " << result.sum_x << endl;
-    cout << "Sum of y: " << result.sum_y << endl;
-    cout << "Sum of xy: " << result.sum_xy << endl;
-    cout << "Sum of x^2: " << result.sum_x2 << endl;
-    cout << "Sum of y^2: " << result.sum_y2 << endl;
-    cout << "Denominator: " << result.denominator << endl;
-    cout << "Linear Regression Equation: y = " << result.slope << "x + " << result.intercept << endl;
-    cout << endl;
-
-    return result;
-}
-
-// Function to count the frequencies of each genre
-void countAllGenresFrequency(const vector<Movie> &movies)
+// Hash aggregation: groups rows by key and folds a value into each group with an aggregate function.
+// Keys and states are kept in flat arrays in the order the groups were first seen, so walking the result
+// gives the same order as the linear-scan group-bys did
+template <typename Key, typename Aggregate>
+class HashAggregator
 {
-    vector<string> allGenres;
+public:
+    using State = typename Aggregate::State;
+
+    size_t size() const { return keys_.size(); }
+    const Key &key(size_t group) const { return keys_[group]; }
+    State &state(size_t group) { return states_[group]; }
+    const State &state(size_t group) const { return states_[group]; }
+    auto result(size_t group) const { return Aggregate::result(states_[group]); }
 
-    for (const auto &movie : movies)
+    void reserve(size_t groups)
     {
-        for (const auto &genre : movie.genres)
-        {
-            // Split the genre string by comma and add individual genres to the list
-            stringstream ss(genre);
-            string individualGenre;
-            while (getline(ss, individualGenre, ','))
-            {
-                allGenres.push_back(trim(individualGenre));
-            }
-        }
+        index_.reserve(groups);
+        keys_.reserve(groups);
+        states_.reserve(groups);
     }
-    mergeSortString(allGenres, 0, static_cast<int>(allGenres.size()) - 1);
 
-    // Count the frequency of each genre
-    int count = 1;
-    for (size_t i = 1; i < allGenres.size(); ++i)
+    // Function to return the group of key, creating an empty one if needed; inserted tells which happened
+    template <typename K>
+    size_t group(const K &key, bool &inserted)
     {
-        if (allGenres[i] != allGenres[i - 1])
+        uint64_t hash = hashKey(key);
+        int64_t found = index_.find(hash, [&](uint32_t group)
         {
-            cout << allGenres[i - 1] << ": " << count << endl;
-            count = 1;
-        }
-        else
+            return keys_[group] == key;
+        });
+        inserted = (found < 0);
+        if (!inserted)
         {
-            count++;
+            return static_cast<size_t>(found);
         }
+        index_.insert(hash);
+        keys_.emplace_back(key);
+        states_.push_back(Aggregate::initial());
+        return keys_.size() - 1;
     }
 
-    // Print the last genre and its count
-    if (!allGenres.empty())
+    // Function to fold value into the group of key, returns the group
+    template <typename K, typename V>
+    size_t add(const K &key, const V &value)
     {
-        cout << allGenres.back() << ": " << count << endl;
+        bool inserted;
+        size_t g = group(key, inserted);
+        Aggregate::add(states_[g], value);
+        return g;
     }
-}
 
-// Function to count the frequency of release years
-void countReleaseYearFrequency(const vector<Movie> &movies)
+    // Function to fold the groups of another aggregator into this one, groups new to this one go at the end
+    void merge(const HashAggregator &other)
+    {
+        for (size_t g = 0; g < other.size(); g++)
+        {
+            bool inserted;
+            size_t target = group(other.keys_[g], inserted);
+            Aggregate::merge(states_[target], other.states_[g]);
+        }
+    }
+
+private:
+    FlatHashIndex index_;
+    vector<Key> keys_;
+    vector<State> states_;
+};
+
+// Dictionary of the distinct values of a categorical column, ids are handed out in order of first appearance
+class Dictionary
 {
-    // Count the frequency of release years manually
-    vector<pair<int, int>> yearFrequency; // Pair to store year and its frequency
+public:
+    StringColumn values; // Value of every id
 
-    for (const auto &movie : movies)
+    size_t size() const { return values.size(); }
+    string_view operator[](uint32_t id) const { return values[id]; }
+
+    // Function to return the id of value, adding it to the dictionary if it is new
+    uint32_t intern(string_view value)
     {
-        string releaseDate = movie.release_date;
-        if (releaseDate.size() >= 4)
+        // A dictionary mapped from a snapshot arrives without an index
+        if (index_.size() != values.size())
         {
-            int year = stoi(releaseDate.substr(releaseDate.size() - 4)); // Extract last four characters as year
-
-            bool found = false;
-            for (auto &freq : yearFrequency)
+            index_.clear();
+            index_.reserve(values.size());
+            for (uint32_t id = 0; id < values.size(); id++)
             {
-                if (freq.first == year)
-                {
-                    freq.second++;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                yearFrequency.emplace_back(year, 1);
+                index_.insert(hashBytes(values[id]));
             }
         }
+        uint64_t hash = hashBytes(value);
+        int64_t found = index_.find(hash, [&](uint32_t id)
+        {
+            return values[id] == value;
+        });
+        if (found >= 0)
+        {
+            return static_cast<uint32_t>(found);
+        }
+        index_.insert(hash);
+        values.push_back(value);
+        return static_cast<uint32_t>(values.size() - 1);
     }
 
-    // Sort the yearFrequency vector in descending order
-    for (size_t i = 0; i < yearFrequency.size(); ++i)
+    // Function to add every value of other and return the translation from its ids to ours
+    vector<uint32_t> merge(const Dictionary &other)
     {
-        for (size_t j = i + 1; j < yearFrequency.size(); ++j)
+        vector<uint32_t> remap(other.size());
+        for (uint32_t id = 0; id < other.size(); id++)
         {
-            if (yearFrequency[i].second < yearFrequency[j].second)
-            {
-                swap(yearFrequency[i], yearFrequency[j]);
-            }
+            remap[id] = intern(other[id]);
         }
+        return remap;
     }
 
-    // Print the year frequencies in descending order
-    for (const auto &yearFreq : yearFrequency)
+private:
+    FlatHashIndex index_;
+};
+
+// Categorical column, every row stores the dictionary id of its value
+class CategoryColumn
+{
+public:
+    Dictionary dictionary;
+    Column<uint32_t> ids;
+
+    size_t size() const { return ids.size(); }
+    uint32_t id(size_t row) const { return ids[row]; }
+    string_view operator[](size_t row) const { return dictionary[ids[row]]; }
+
+    void push_back(string_view value)
     {
-        cout << yearFreq.first << ": " << yearFreq.second << endl;
+        ids.push_back(dictionary.intern(value));
     }
-}
 
-// Function to insert a new WordFrequency into the vector of structs
-void insert(vector<WordFrequency> &wordFreq, const string &word)
-{
-    for (auto &wf : wordFreq)
+    // Function to move the rows of another column to the end of this one
+    void append(CategoryColumn &&other)
     {
-        if (wf.word == word)
+        vector<uint32_t> remap = dictionary.merge(other.dictionary);
+        for (uint32_t id : other.ids)
         {
-            wf.frequency++;
-            return;
+            ids.push_back(remap[id]);
         }
+        other = CategoryColumn();
     }
-    wordFreq.push_back({word, 1});
-}
+};
 
-// Function to count word frequencies in movie titles, ignoring certain words
-vector<WordFrequency> countWords(const vector<Movie> &movies, vector<string> &ignoredWords)
+// Column of categorical lists, the entries of row i are ids [row_offsets[i], row_offsets[i + 1])
+class ListColumn
 {
-    vector<WordFrequency> wordFreq;
-
-    // Iterate through each movie
-    for (const Movie &movie : movies)
+public:
+    Dictionary dictionary;
+    Column<uint32_t> ids;
+    Column<uint64_t> row_offsets = {0};
+
+    size_t size() const { return row_offsets.size() - 1; }
+    size_t first(size_t row) const { return row_offsets[row]; }
+    size_t last(size_t row) const { return row_offsets[row + 1]; }
+    uint32_t id(size_t j) const { return ids[j]; }
+    string_view value(size_t j) const { return dictionary[ids[j]]; }
+
+    // Function to add a row holding the non-empty pieces of text split by delimiter
+    void push_back(string_view text, char delimiter)
     {
-        stringstream ss(movie.title); // Convert title to stringstream for easy tokenization
-        string word;
-
-        // Iterate through each word in the movie title
-        while (ss >> word)
+        size_t start = 0;
+        while (start <= text.size())
         {
-            // Convert word to lowercase
-            string lowercaseWord;
-            for (char c : word)
+            size_t end = text.find(delimiter, start);
+            if (end == string_view::npos)
             {
-                lowercaseWord += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+                end = text.size();
             }
-
-            // If the word is not in the ignored list, update its frequency
-            if (!binarySearch(ignoredWords, lowercaseWord))
+            if (end > start)
             {
-                // Check if the lowercase word already exists in wordFreq
-                bool found = false;
-                for (WordFrequency &wf : wordFreq)
-                {
-                    if (wf.word == lowercaseWord)
-                    {
-                        wf.frequency++;
-                        found = true;
-                        break;
-                    }
-                }
-
-                // If the lowercase word doesn't exist, add it to wordFreq
-                if (!found)
-                {
-                    wordFreq.push_back({lowercaseWord, 1});
-                }
+                ids.push_back(dictionary.intern(text.substr(start, end - start)));
             }
+            start = end + 1;
         }
+        row_offsets.push_back(ids.size());
     }
 
-    return wordFreq;
-}
-
-// Function to count the freqencies of words in titles according to each original language
-vector<vector<WordFrequency>> countTitleWordsByOriginalLanguage(const vector<Movie> &movies, vector<string> &ignoredLanguages, vector<string> &ignoredWords)
-{
-    vector<vector<WordFrequency>> languageTitleWordFreq;
-
-    bucketSort(ignoredLanguages);
-
-    for (const Movie &movie : movies)
+    void append(ListColumn &&other)
     {
-        bool skipMovie = false;
-        // Check if the current movie's original language is in the list of ignored languages
-        if (binarySearch(ignoredLanguages, movie.original_language))
+        vector<uint32_t> remap = dictionary.merge(other.dictionary);
+        uint64_t base = ids.size();
+        for (uint32_t id : other.ids)
         {
-            skipMovie = true;
+            ids.push_back(remap[id]);
         }
-        if (skipMovie)
+        for (size_t i = 1; i < other.row_offsets.size(); i++)
         {
-            continue; // Skip processing for this movie
+            row_offsets.push_back(base + other.row_offsets[i]);
         }
+        other = ListColumn();
+    }
+};
 
-        stringstream ss(movie.title);
-        string titleWord;
-
-        while (ss >> titleWord)
-        {
-            // Convert word to lowercase and remove leading/trailing punctuation marks
-            string lowercaseWord;
-            for (char c : titleWord)
-            {
-                if (isalnum(c)) // Check if the character is alphanumeric
-                {
-                    lowercaseWord += tolower(c); // Convert to lowercase
-                }
-                else if (!lowercaseWord.empty()) // Only append non-leading/trailing punctuation
-                {
-                    break;
-                }
-            }
-
-            // Check if the lowercase word is not in the list of ignored words
-            if (!binarySearch(ignoredWords, lowercaseWord) && !lowercaseWord.empty())
-            {
-                // Find or create language entry
-                bool foundLanguage = false;
-                for (vector<WordFrequency> &languageEntry : languageTitleWordFreq)
-                {
-                    if (languageEntry[0].word == movie.original_language)
-                    {
-                        foundLanguage = true;
-                        // Update word frequencies for this original language
-                        bool foundWord = false;
-                        for (size_t i = 1; i < languageEntry.size(); i++)
-                        {
-                            if (languageEntry[i].word == lowercaseWord)
-                            {
-                                foundWord = true;
-                                // Increment word frequency
-                                languageEntry[i].frequency++;
-                                break;
-                            }
-                        }
-                        if (!foundWord)
-                        {
-                            // Add new word and frequency
-                            languageEntry.push_back({lowercaseWord, 1});
-                        }
-                        break;
-                    }
-                }
-                if (!foundLanguage)
-                {
-                    // Create new language entry
-                    vector<WordFrequency> newLanguageEntry;
-                    newLanguageEntry.push_back({movie.original_language, 1});
-                    newLanguageEntry.push_back({lowercaseWord, 1});
-                    languageTitleWordFreq.push_back(newLanguageEntry);
-                }
-            }
-        }
+// Structure-of-arrays storage for the movie dataset. Every column holds one value per row,
+// so a scan over revenue or vote_average touches only that column's memory
+class MovieTable
+{
+public:
+    // Numeric columns
+    Column<float> vote_average;
+    Column<int> vote_count;
+    Column<long long> revenue;
+    Column<int> runtime;
+    Column<char> adult;
+    Column<long long> budget;
+    Column<float> popularity;
+    Column<int32_t> released; // Release date packed as year * 10000 + month * 100 + day, 0 if missing or malformed
+
+    // Validity of the numeric columns above, a clear bit marks an empty or malformed field that was read as 0
+    ValidityBitmap vote_average_valid;
+    ValidityBitmap vote_count_valid;
+    ValidityBitmap revenue_valid;
+    ValidityBitmap runtime_valid;
+    ValidityBitmap budget_valid;
+    ValidityBitmap popularity_valid;
+
+    // Text columns
+    StringColumn title;
+    StringColumn status;
+    StringColumn release_date;
+    StringColumn original_title;
+    StringColumn overview;
+    StringColumn tagline;
+
+    // Categorical columns
+    CategoryColumn original_language;
+    ListColumn genres;
+    ListColumn production_companies;
+    ListColumn production_countries;
+    ListColumn spoken_languages;
+
+    // Snapshot mapping the columns borrow from, if the table was loaded from one
+    shared_ptr<const MappedFile> mapping;
+
+    // Number of movies, counted apart from the columns since a table loaded with a column set leaves some empty
+    uint64_t rows = 0;
+
+    size_t size() const { return rows; }
+
+    // Function to move the rows of another table to the end of this one
+    void append(MovieTable &&other)
+    {
+        appendColumn(vote_average, other.vote_average);
+        appendColumn(vote_count, other.vote_count);
+        appendColumn(revenue, other.revenue);
+        appendColumn(runtime, other.runtime);
+        appendColumn(adult, other.adult);
+        appendColumn(budget, other.budget);
+        appendColumn(popularity, other.popularity);
+        appendColumn(released, other.released);
+        vote_average_valid.append(move(other.vote_average_valid));
+        vote_count_valid.append(move(other.vote_count_valid));
+        revenue_valid.append(move(other.revenue_valid));
+        runtime_valid.append(move(other.runtime_valid));
+        budget_valid.append(move(other.budget_valid));
+        popularity_valid.append(move(other.popularity_valid));
+        title.append(move(other.title));
+        status.append(move(other.status));
+        release_date.append(move(other.release_date));
+        original_language.append(move(other.original_language));
+        original_title.append(move(other.original_title));
+        overview.append(move(other.overview));
+        tagline.append(move(other.tagline));
+        genres.append(move(other.genres));
+        production_companies.append(move(other.production_companies));
+        production_countries.append(move(other.production_countries));
+        spoken_languages.append(move(other.spoken_languages));
+        rows += other.rows;
+        other.rows = 0;
     }
 
-    return languageTitleWordFreq;
-}
+private:
+    template <typename T>
+    static void appendColumn(Column<T> &column, Column<T> &other)
+    {
+        column.append(other.begin(), other.end());
+        other = Column<T>();
+    }
+};
 
-// Function to count word frequencies in movie titles segregated by year
-vector<pair<int, vector<WordFrequency>>> countTitleWordsByYear(const vector<Movie> &movies, vector<string> &ignoredWords)
+// Validity bitmaps of the table and the names of the columns they describe
+const pair<const char *, ValidityBitmap MovieTable::*> VALIDITY_BITMAPS[] = {
+    {"vote_average", &MovieTable::vote_average_valid},
+    {"vote_count", &MovieTable::vote_count_valid},
+    {"revenue", &MovieTable::revenue_valid},
+    {"runtime", &MovieTable::runtime_valid},
+    {"budget", &MovieTable::budget_valid},
+    {"popularity", &MovieTable::popularity_valid}};
+
+// Function to call visit on every raw column of the table, in a fixed order.
+// Snapshot reading and writing both walk the table through this list
+template <typename Table, typename Visitor>
+void forEachColumn(Table &table, Visitor &&visit)
+{
+    visit(table.vote_average);
+    visit(table.vote_count);
+    visit(table.revenue);
+    visit(table.runtime);
+    visit(table.adult);
+    visit(table.budget);
+    visit(table.popularity);
+    visit(table.released);
+    for (auto *text : {&table.title, &table.status, &table.release_date, &table.original_title, &table.overview, &table.tagline})
+    {
+        visit(text->bytes);
+        visit(text->offsets);
+    }
+    visit(table.original_language.dictionary.values.bytes);
+    visit(table.original_language.dictionary.values.offsets);
+    visit(table.original_language.ids);
+    for (auto *list : {&table.genres, &table.production_companies, &table.production_countries, &table.spoken_languages})
+    {
+        visit(list->dictionary.values.bytes);
+        visit(list->dictionary.values.offsets);
+        visit(list->ids);
+        visit(list->row_offsets);
+    }
+    for (const auto &bitmap : VALIDITY_BITMAPS)
+    {
+        visit((table.*bitmap.second).words);
+    }
+}
+
+// Ordered view over the rows of a table. Position i of the view is row rows()[i] of the table,
+// so reordering the dataset only moves row indices and never the movies themselves
+class TableView
+{
+public:
+    // Function to create a view showing every row of the table in storage order
+    explicit TableView(const MovieTable &table) : table_(&table), rows_(table.size())
+    {
+        for (size_t row = 0; row < rows_.size(); row++)
+        {
+            rows_[row] = row;
+        }
+    }
+
+    TableView(const MovieTable &table, vector<uint64_t> rows) : table_(&table), rows_(move(rows)) {}
+
+    const MovieTable &table() const { return *table_; }
+    const vector<uint64_t> &rows() const { return rows_; }
+    size_t size() const { return rows_.size(); }
+    size_t row(size_t i) const { return rows_[i]; }
+
+private:
+    const MovieTable *table_;
+    vector<uint64_t> rows_;
+};
+
+// Structure to store title words and their frequency
+struct WordFrequency
+{
+    string word;
+    int frequency;
+};
+
+struct CorrelationResult
+{
+    double correlation_coefficient;
+    double sum_x;
+    double sum_y;
+    double sum_xy;
+    double sum_x2;
+    double sum_y2;
+    double denominator;
+    double slope;
+    double intercept;
+};
+
+// Struct to hold production company information
+struct CompanyInfo
+{
+    string name;
+    long long totalRevenue;
+    vector<string> producedCountries;
+};
+
+// Function to remove leading and trailing spaces from a string
+string trim(const string &str)
+{
+    size_t start = str.find_first_not_of(" \t\n\r\f\v");
+    size_t end = str.find_last_not_of(" \t\n\r\f\v");
+    if (start == string::npos || end == string::npos)
+    {
+        return "";
+    }
+    return str.substr(start, end - start + 1);
+}
+
+// Function to split a string by a delimiter and return non-empty tokens as vector
+vector<string> split(const string &line, char delimiter)
+{
+    vector<string> tokens;
+    stringstream ss(line);
+    string token;
+    while (getline(ss, token, delimiter))
+    {
+        if (!token.empty())
+        {
+            tokens.push_back(token);
+        }
+    }
+    return tokens;
+}
+
+// Number of columns in each record of the movie CSV
+const size_t CSV_COLUMNS = 23;
+
+// Positions of the stored columns in a record of the movie CSV
+enum CsvColumn
+{
+    CSV_TITLE = 1,
+    CSV_VOTE_AVERAGE = 2,
+    CSV_VOTE_COUNT = 3,
+    CSV_STATUS = 4,
+    CSV_RELEASE_DATE = 5,
+    CSV_REVENUE = 6,
+    CSV_RUNTIME = 7,
+    CSV_ADULT = 8,
+    CSV_BUDGET = 10,
+    CSV_ORIGINAL_LANGUAGE = 13,
+    CSV_ORIGINAL_TITLE = 14,
+    CSV_OVERVIEW = 15,
+    CSV_POPULARITY = 16,
+    CSV_TAGLINE = 18,
+    CSV_GENRES = 19,
+    CSV_PRODUCTION_COMPANIES = 20,
+    CSV_PRODUCTION_COUNTRIES = 21,
+    CSV_SPOKEN_LANGUAGES = 22
+};
+
+// Set of CSV columns to load, bit i stands for column i. The other columns are only scanned for their end
+using ColumnSet = uint32_t;
+const ColumnSet ALL_COLUMNS = (1u << CSV_COLUMNS) - 1;
+
+constexpr ColumnSet columnBit(CsvColumn column)
+{
+    return 1u << column;
+}
+
+// Function to find how many leading fields of a record hold every column of the set
+size_t columnLimit(ColumnSet columns)
+{
+    size_t limit = 0;
+    while (limit < CSV_COLUMNS && (columns >> limit) != 0)
+    {
+        limit++;
+    }
+    return limit;
+}
+
+// Function to check whether the quote at index i closes a quoted field, i.e. it is followed by the
+// delimiter, a line break or the end of the input
+bool isClosingQuote(string_view data, size_t i, char delimiter)
+{
+    size_t next = i + 1;
+    return next == data.size() || data[next] == delimiter || data[next] == '\n' ||
+           (data[next] == '\r' && (next + 1 == data.size() || data[next + 1] == '\n'));
+}
+
+// Function to split one CSV record starting at pos into views over the input bytes.
+// A field that starts with a double quote runs until a quote followed by the delimiter or the end of the
+// line, and is stored without its outer quotes; columns flagged in remove_quotes lose one more pair.
+// Returns the number of fields in the record and moves pos to the start of the next record
+size_t splitRecord(string_view data, size_t &pos, char delimiter, string_view *fields, size_t max_fields, const vector<bool> &remove_quotes)
+{
+    size_t count = 0;
+    size_t n = data.size();
+    while (true)
+    {
+        size_t start = pos;
+        size_t end;
+        if (pos < n && data[pos] == '"')
+        {
+            // Quoted field, delimiters and line breaks inside it belong to the field
+            size_t i = pos + 1;
+            while (true)
+            {
+                i = data.find('"', i);
+                if (i == string_view::npos)
+                {
+                    cerr << "Error: Ending quote not found for token: " << data.substr(pos, 80) << endl;
+                    i = n;
+                    break;
+                }
+                if (isClosingQuote(data, i, delimiter))
+                {
+                    break;
+                }
+                i++;
+            }
+            start = pos + 1;
+            end = i;
+            pos = (i < n) ? i + 1 : n;
+        }
+        else
+        {
+            while (pos < n && data[pos] != delimiter && data[pos] != '\n')
+            {
+                pos++;
+            }
+            end = pos;
+            if (end > start && data[end - 1] == '\r' && (pos == n || data[pos] == '\n'))
+            {
+                end--;
+            }
+        }
+
+        if (count < max_fields)
+        {
+            string_view field = data.substr(start, end - start);
+            if (count < remove_quotes.size() && remove_quotes[count] && field.size() >= 2 && field.front() == '"' && field.back() == '"')
+            {
+                field = field.substr(1, field.size() - 2);
+            }
+            fields[count] = field;
+        }
+        count++;
+
+        // Skip a carriage return left after a closing quote
+        if (pos + 1 < n && data[pos] == '\r' && data[pos + 1] == '\n')
+        {
+            pos++;
+        }
+        if (pos < n && data[pos] == delimiter)
+        {
+            pos++;
+            continue;
+        }
+        if (pos < n && data[pos] == '\n')
+        {
+            pos++;
+        }
+        return count;
+    }
+}
+
+// Function to split a view by a delimiter into a list of its non-empty pieces. The text is copied into the
+// arena once and the pieces point into the copy
+TextList splitView(string_view text, char delimiter, Arena &arena)
+{
+    text = arena.copy(text);
+    auto forEachPiece = [&](auto visit)
+    {
+        size_t start = 0;
+        while (start <= text.size())
+        {
+            size_t end = text.find(delimiter, start);
+            if (end == string_view::npos)
+            {
+                end = text.size();
+            }
+            if (end > start)
+            {
+                visit(text.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    };
+
+    // Count the pieces first so the list is allocated at its final size
+    uint32_t count = 0;
+    forEachPiece([&](string_view)
+    {
+        count++;
+    });
+    if (count == 0)
+    {
+        return TextList();
+    }
+    string_view *items = static_cast<string_view *>(arena.allocate(count * sizeof(string_view), alignof(string_view)));
+    uint32_t stored = 0;
+    forEachPiece([&](string_view piece)
+    {
+        new (&items[stored++]) string_view(piece);
+    });
+    return TextList(items, count);
+}
+
+// Function to convert a numeric field straight from the input bytes. from_chars neither allocates nor
+// consults the locale, and reports a bad field instead of throwing. Returns false if the field is empty
+// or holds anything but one number; value is then the number the field starts with, or 0
+template <typename T>
+bool parseNumber(string_view field, T &value)
+{
+    const char *first = field.data();
+    const char *last = field.data() + field.size();
+    while (first < last && *first == ' ')
+    {
+        first++;
+    }
+    if (first < last && *first == '+')
+    {
+        first++;
+    }
+    value = 0;
+    from_chars_result result = from_chars(first, last, value);
+    return first < last && result.ec == errc() && result.ptr == last;
+}
+
+// Function to pack a release date into year * 10000 + month * 100 + day, so dates compare as integers and
+// date / 10000 is the year. Takes the month/day/year dates of the movie CSV as well as year-month-day and a
+// bare year, whose month and day are 0. Returns 0 for an empty or malformed date
+int32_t parseReleaseDate(string_view date)
+{
+    int parts[3] = {0, 0, 0};
+    size_t count = 0;
+    const char *first = date.data();
+    const char *last = date.data() + date.size();
+    char separator = 0;
+    while (first < last && count < 3)
+    {
+        from_chars_result result = from_chars(first, last, parts[count]);
+        if (result.ec != errc() || parts[count] < 0)
+        {
+            return 0;
+        }
+        count++;
+        first = result.ptr;
+        if (first == last)
+        {
+            break;
+        }
+        if ((*first != '/' && *first != '-') || (separator != 0 && *first != separator))
+        {
+            return 0;
+        }
+        separator = *first++;
+        if (first == last)
+        {
+            return 0;
+        }
+    }
+    if (first != last || count == 0 || count == 2)
+    {
+        return 0;
+    }
+    int year = parts[0], month = 0, day = 0;
+    if (count == 3 && separator == '/')
+    {
+        month = parts[0];
+        day = parts[1];
+        year = parts[2];
+    }
+    else if (count == 3)
+    {
+        month = parts[1];
+        day = parts[2];
+    }
+    if (year < 1 || year > 9999 || month > 12 || day > 31 || (count == 3 && (month == 0 || day == 0)))
+    {
+        return 0;
+    }
+    return year * 10000 + month * 100 + day;
+}
+
+// Function to read the year out of a packed release date
+int releaseYear(int32_t date)
+{
+    return date / 10000;
+}
+
+// Function to convert a numeric field into its column, and record in the bitmap whether it was well-formed
+template <typename T>
+void appendNumber(Column<T> &column, ValidityBitmap &validity, string_view field)
+{
+    T value;
+    validity.push_back(parseNumber(field, value));
+    column.push_back(value);
+}
+
+// Function to build a Movie from the fields of one record, copying only the columns that are stored.
+// The text is copied into the arena, the mapped file can go away afterwards
+Movie parseMovie(const string_view *tokens, Arena &arena)
+{
+    Movie movie;
+    movie.title = arena.copy(tokens[1]);
+    parseNumber(tokens[2], movie.vote_average);
+    parseNumber(tokens[3], movie.vote_count);
+    movie.status = arena.copy(tokens[4]);
+    movie.release_date = arena.copy(tokens[5]);
+    parseNumber(tokens[6], movie.revenue);
+    parseNumber(tokens[7], movie.runtime);
+    movie.adult = (tokens[8] == "False" || tokens[8] == "0");
+    parseNumber(tokens[10], movie.budget);
+    movie.original_language = arena.copy(tokens[13]);
+    movie.original_title = arena.copy(tokens[14]);
+    movie.overview = arena.copy(tokens[15]);
+    parseNumber(tokens[16], movie.popularity);
+    movie.tagline = arena.copy(tokens[18]);
+
+    // Split the list columns straight from the mapped bytes
+    movie.genres = splitView(tokens[19], '|', arena);
+    movie.production_companies = splitView(tokens[20], '|', arena);
+    movie.production_countries = splitView(tokens[21], '|', arena);
+    movie.spoken_languages = splitView(tokens[22], '|', arena);
+
+    return movie;
+}
+
+// Functions to add the fields of one record to a row container. Movies always hold every column, a table
+// only converts and stores the columns in the set and leaves the others empty
+void appendRecord(MovieRows &rows, const string_view *tokens, ColumnSet)
+{
+    rows.movies.push_back(parseMovie(tokens, rows.arena));
+}
+
+void appendRecord(MovieTable &table, const string_view *tokens, ColumnSet columns)
+{
+    auto wanted = [columns](CsvColumn column)
+    {
+        return (columns & columnBit(column)) != 0;
+    };
+    if (wanted(CSV_VOTE_AVERAGE))
+        appendNumber(table.vote_average, table.vote_average_valid, tokens[CSV_VOTE_AVERAGE]);
+    if (wanted(CSV_VOTE_COUNT))
+        appendNumber(table.vote_count, table.vote_count_valid, tokens[CSV_VOTE_COUNT]);
+    if (wanted(CSV_REVENUE))
+        appendNumber(table.revenue, table.revenue_valid, tokens[CSV_REVENUE]);
+    if (wanted(CSV_RUNTIME))
+        appendNumber(table.runtime, table.runtime_valid, tokens[CSV_RUNTIME]);
+    if (wanted(CSV_ADULT))
+        table.adult.push_back(tokens[CSV_ADULT] == "False" || tokens[CSV_ADULT] == "0");
+    if (wanted(CSV_BUDGET))
+        appendNumber(table.budget, table.budget_valid, tokens[CSV_BUDGET]);
+    if (wanted(CSV_POPULARITY))
+        appendNumber(table.popularity, table.popularity_valid, tokens[CSV_POPULARITY]);
+    if (wanted(CSV_TITLE))
+        table.title.push_back(tokens[CSV_TITLE]);
+    if (wanted(CSV_STATUS))
+        table.status.push_back(tokens[CSV_STATUS]);
+    if (wanted(CSV_RELEASE_DATE))
+    {
+        table.release_date.push_back(tokens[CSV_RELEASE_DATE]);
+        table.released.push_back(parseReleaseDate(tokens[CSV_RELEASE_DATE]));
+    }
+    if (wanted(CSV_ORIGINAL_LANGUAGE))
+        table.original_language.push_back(tokens[CSV_ORIGINAL_LANGUAGE]);
+    if (wanted(CSV_ORIGINAL_TITLE))
+        table.original_title.push_back(tokens[CSV_ORIGINAL_TITLE]);
+    if (wanted(CSV_OVERVIEW))
+        table.overview.push_back(tokens[CSV_OVERVIEW]);
+    if (wanted(CSV_TAGLINE))
+        table.tagline.push_back(tokens[CSV_TAGLINE]);
+    if (wanted(CSV_GENRES))
+        table.genres.push_back(tokens[CSV_GENRES], '|');
+    if (wanted(CSV_PRODUCTION_COMPANIES))
+        table.production_companies.push_back(tokens[CSV_PRODUCTION_COMPANIES], '|');
+    if (wanted(CSV_PRODUCTION_COUNTRIES))
+        table.production_countries.push_back(tokens[CSV_PRODUCTION_COUNTRIES], '|');
+    if (wanted(CSV_SPOKEN_LANGUAGES))
+        table.spoken_languages.push_back(tokens[CSV_SPOKEN_LANGUAGES], '|');
+    table.rows++;
+}
+
+// Functions to move the rows parsed by one thread to the end of the result
+void appendRows(MovieRows &rows, MovieRows &&part)
+{
+    rows.movies.insert(rows.movies.end(), part.movies.begin(), part.movies.end());
+    rows.arena.adopt(move(part.arena));
+    vector<Movie>().swap(part.movies);
+}
+
+void appendRows(MovieTable &table, MovieTable &&part)
+{
+    table.append(move(part));
+}
+
+// Function to parse every record that starts in [pos, end) and append the columns in the set to rows.
+// Fields past the last column in the set are only scanned for their end, never stored or converted.
+// Returns the position after the last record parsed, which is past end if that record crosses it
+template <typename Rows>
+size_t parseRecords(string_view data, size_t pos, size_t end, const vector<bool> &remove_quotes, Rows &rows, ColumnSet columns = ALL_COLUMNS)
+{
+    string_view tokens[CSV_COLUMNS];
+    // The first field is always split, it tells blank lines apart
+    size_t limit = max<size_t>(1, columnLimit(columns));
+    while (pos < end)
+    {
+        size_t record_start = pos;
+        size_t count = splitRecord(data, pos, ',', tokens, limit, remove_quotes);
+
+        // Skip blank lines
+        if (count == 1 && tokens[0].empty() && pos - record_start <= 2)
+        {
+            continue;
+        }
+        // Missing trailing columns are treated as empty
+        for (size_t i = count; i < limit; i++)
+        {
+            tokens[i] = string_view();
+        }
+
+        appendRecord(rows, tokens, columns);
+    }
+    return pos;
+}
+
+// Function to run the record scanner over [begin, end) without building fields.
+// in_quotes says whether begin lies inside a quoted field; the return value says the same for end.
+// first_record receives the first position in the range where a record starts, or npos
+bool scanQuoteState(string_view data, size_t begin, size_t end, bool in_quotes, char delimiter, size_t &first_record)
+{
+    first_record = in_quotes ? string_view::npos : begin;
+    bool field_start = !in_quotes;
+    for (size_t i = begin; i < end; i++)
+    {
+        char c = data[i];
+        if (in_quotes)
+        {
+            if (c == '"' && isClosingQuote(data, i, delimiter))
+            {
+                in_quotes = false;
+            }
+            continue;
+        }
+        if (c == '\n')
+        {
+            if (first_record == string_view::npos)
+            {
+                first_record = i + 1;
+            }
+            field_start = true;
+        }
+        else if (c == delimiter)
+        {
+            field_start = true;
+        }
+        else
+        {
+            in_quotes = (c == '"' && field_start);
+            field_start = false;
+        }
+    }
+    return in_quotes;
+}
+
+// Function to parse the records after the header on several threads.
+// The input is cut into byte ranges at line breaks. A line break may sit inside a quoted overview or tagline,
+// so each range is scanned twice, once assuming it starts at a record and once assuming it starts inside quotes.
+// Chaining the end states from the first range on tells every range which guess was right, and therefore where
+// its first real record starts. Each range is then parsed as its own task and the results are joined in file order
+template <typename Rows>
+void parseChunks(string_view data, size_t pos, const vector<bool> &remove_quotes, WorkStealingPool &pool, Rows &rows, ColumnSet columns)
+{
+    // Cut the rest of the file into ranges that begin right after a line break
+    size_t chunks = pool.size();
+    vector<size_t> bounds = {pos};
+    for (size_t i = 1; i < chunks; i++)
+    {
+        size_t cut = pos + (data.size() - pos) * i / chunks;
+        cut = data.find('\n', max(cut, bounds.back()));
+        cut = (cut == string_view::npos) ? data.size() : cut + 1;
+        if (cut > bounds.back() && cut < data.size())
+        {
+            bounds.push_back(cut);
+        }
+    }
+    bounds.push_back(data.size());
+    chunks = bounds.size() - 1;
+
+    // Scan every range under both starting assumptions
+    vector<char> end_state[2] = {vector<char>(chunks), vector<char>(chunks)};
+    vector<size_t> first_record[2] = {vector<size_t>(chunks), vector<size_t>(chunks)};
+    pool.run(chunks, [&](size_t c)
+    {
+        for (int assume = 0; assume < 2; assume++)
+        {
+            end_state[assume][c] = scanQuoteState(data, bounds[c], bounds[c + 1], assume == 1, ',', first_record[assume][c]);
+        }
+    });
+
+    // Resolve the real state at each range start, the first range always starts at a record
+    vector<size_t> starts(chunks);
+    bool in_quotes = false;
+    for (size_t c = 0; c < chunks; c++)
+    {
+        starts[c] = first_record[in_quotes][c];
+        in_quotes = end_state[in_quotes][c];
+    }
+
+    // Parse every range into its own container
+    vector<Rows> parts(chunks);
+    pool.run(chunks, [&](size_t c)
+    {
+        if (starts[c] != string_view::npos)
+        {
+            parseRecords(data, starts[c], bounds[c + 1], remove_quotes, parts[c], columns);
+        }
+    });
+
+    // Join the ranges in file order
+    for (Rows &part : parts)
+    {
+        appendRows(rows, move(part));
+    }
+}
+
+// Function to read the columns in the set from the CSV file into a row container, on every thread of the pool
+template <typename Rows>
+Rows readCSV(const string &filename, const vector<bool> &remove_quotes, WorkStealingPool &pool, ColumnSet columns = ALL_COLUMNS)
+{
+    Rows rows;
+
+    MappedFile file(filename);
+    if (!file.is_open())
+    {
+        cerr << "Error opening file: " << filename << endl;
+        return rows;
+    }
+
+    string_view data = file.view();
+    string_view tokens[CSV_COLUMNS];
+    size_t pos = 0;
+    // Skip header line
+    splitRecord(data, pos, ',', tokens, CSV_COLUMNS, remove_quotes);
+    if (pool.size() > 1)
+    {
+        parseChunks(data, pos, remove_quotes, pool, rows, columns);
+    }
+    else
+    {
+        parseRecords(data, pos, data.size(), remove_quotes, rows, columns);
+    }
+
+    return rows;
+}
+
+// Function to parse the CSV file and store contents
+MovieRows parseCSV(const string &filename, vector<bool> &remove_quotes)
+{
+    WorkStealingPool serial(1);
+    return readCSV<MovieRows>(filename, remove_quotes, serial);
+}
+
+// Function to parse the CSV file on several threads, see parseChunks
+MovieRows parseCSVParallel(const string &filename, vector<bool> &remove_quotes, WorkStealingPool &pool)
+{
+    return readCSV<MovieRows>(filename, remove_quotes, pool);
+}
+
+// Function to load the CSV file straight into columns, only the columns in the set are filled
+MovieTable loadMovieTable(const string &filename, const vector<bool> &remove_quotes, WorkStealingPool &pool, ColumnSet columns = ALL_COLUMNS)
+{
+    return readCSV<MovieTable>(filename, remove_quotes, pool, columns);
+}
+
+// Index of the rows of a table by release year. The rows of each year are stored together in storage order,
+// so the movies of a year, or of a range of dates, are found without scanning the table
+class YearIndex
+{
+public:
+    explicit YearIndex(const MovieTable &table)
+    {
+        // Counting sort on the year, rows without a release date are left out
+        int first = numeric_limits<int>::max(), last = numeric_limits<int>::min();
+        for (int32_t date : table.released)
+        {
+            if (date != 0)
+            {
+                first = min(first, releaseYear(date));
+                last = max(last, releaseYear(date));
+            }
+        }
+        if (first > last)
+        {
+            return;
+        }
+        firstYear_ = first;
+        offsets_.assign(last - first + 2, 0);
+        for (int32_t date : table.released)
+        {
+            if (date != 0)
+            {
+                offsets_[releaseYear(date) - first + 1]++;
+            }
+        }
+        for (size_t y = 1; y < offsets_.size(); y++)
+        {
+            offsets_[y] += offsets_[y - 1];
+        }
+        rows_.resize(offsets_.back());
+        vector<uint64_t> next(offsets_.begin(), offsets_.end() - 1);
+        for (size_t row = 0; row < table.released.size(); row++)
+        {
+            if (table.released[row] != 0)
+            {
+                rows_[next[releaseYear(table.released[row]) - first]++] = row;
+            }
+        }
+    }
+
+    // Function to get the rows released in a year as a [first, last) range, in storage order
+    pair<const uint64_t *, const uint64_t *> rows(int year) const
+    {
+        if (offsets_.empty() || year < firstYear_ || year - firstYear_ + 1 >= static_cast<int>(offsets_.size()))
+        {
+            return {nullptr, nullptr};
+        }
+        return {rows_.data() + offsets_[year - firstYear_], rows_.data() + offsets_[year - firstYear_ + 1]};
+    }
+
+    // Function to collect the rows released between two packed dates, both included, earliest year first.
+    // Only the years in the range are visited. released is the column of the table the index was built from;
+    // the index holds row numbers only, so it stays valid while that table keeps its rows, wherever it lives
+    vector<uint64_t> rowsBetween(const Column<int32_t> &released, int32_t from, int32_t to) const
+    {
+        vector<uint64_t> found;
+        for (int year = releaseYear(from); year <= releaseYear(to); year++)
+        {
+            auto range = rows(year);
+            for (const uint64_t *row = range.first; row != range.second; row++)
+            {
+                int32_t date = released[*row];
+                if (date >= from && date <= to)
+                {
+                    found.push_back(*row);
+                }
+            }
+        }
+        return found;
+    }
+
+private:
+    int firstYear_ = 0;
+    vector<uint64_t> offsets_; // Rows of year firstYear_ + y are rows_[offsets_[y]] to rows_[offsets_[y + 1]]
+    vector<uint64_t> rows_;
+};
+
+// Function to warn about the numeric fields that were empty or malformed and were read as 0
+void warnInvalidFields(const MovieTable &table, const string &filename)
+{
+    for (const auto &bitmap : VALIDITY_BITMAPS)
+    {
+        size_t invalid = (table.*bitmap.second).countInvalid();
+        if (invalid > 0)
+        {
+            cerr << "Warning: " << invalid << " movies in " << filename << " have an empty or malformed " << bitmap.first << ", read as 0" << endl;
+        }
+    }
+}
+
+// Size, modification time and content hash of the CSV a snapshot was built from
+struct SourceIdentity
+{
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t hash = 0;
+};
+
+// Function to read the identity of a CSV file, returns false if it cannot be read.
+// Without hash_contents only the size and modification time are read and the hash is left at 0
+bool identifySource(const string &filename, SourceIdentity &identity, bool hash_contents = true)
+{
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    identity.size = static_cast<uint64_t>(info.st_size);
+    identity.mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    identity.hash = 0;
+    if (hash_contents)
+    {
+        MappedFile file(filename);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        identity.hash = hashBytes(file.view());
+    }
+    return true;
+}
+
+// Function to hash the parser settings, a snapshot built with other settings is not reused
+uint64_t parserConfigHash(const vector<bool> &remove_quotes)
+{
+    string config = to_string(CSV_COLUMNS) + ":";
+    for (bool remove : remove_quotes)
+    {
+        config += remove ? '1' : '0';
+    }
+    return hashBytes(config);
+}
+
+// Snapshot file layout: a header, one section entry per column in forEachColumn order, then the column data.
+// Every location is an offset from the start of the file, so the file can be mapped at any address and
+// shared read-only by several processes
+const char SNAPSHOT_MAGIC[8] = {'M', 'O', 'V', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_VERSION = 4;
+const uint64_t SNAPSHOT_ALIGNMENT = 64;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t sections;
+    uint64_t rows;
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t source_hash;
+    uint64_t config_hash;
+};
+
+struct SnapshotSection
+{
+    uint64_t offset; // Byte offset of the column data from the start of the file
+    uint64_t count;  // Number of values in the column
+};
+
+uint64_t alignSnapshotOffset(uint64_t offset)
+{
+    return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+// Function to write the table to a snapshot file. The file is written next to its final name and renamed
+// into place, so a reader never maps a half-written snapshot
+bool saveSnapshot(const string &path, const MovieTable &table, const SourceIdentity &source, uint64_t config_hash)
+{
+    vector<SnapshotSection> sections;
+    forEachColumn(table, [&](const auto &column)
+    {
+        sections.push_back({0, column.size()});
+    });
+
+    uint64_t offset = alignSnapshotOffset(sizeof(SnapshotHeader) + sections.size() * sizeof(SnapshotSection));
+    size_t index = 0;
+    forEachColumn(table, [&](const auto &column)
+    {
+        using T = typename decay_t<decltype(column)>::value_type;
+        sections[index++].offset = offset;
+        offset = alignSnapshotOffset(offset + column.size() * sizeof(T));
+    });
+
+    SnapshotHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.sections = static_cast<uint32_t>(sections.size());
+    header.rows = table.size();
+    header.source_size = source.size;
+    header.source_mtime_ns = source.mtime_ns;
+    header.source_hash = source.hash;
+    header.config_hash = config_hash;
+
+    string temp = path + ".tmp";
+    ofstream out(temp, ios::binary | ios::trunc);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(sections.data()), sections.size() * sizeof(SnapshotSection));
+    index = 0;
+    forEachColumn(table, [&](const auto &column)
+    {
+        using T = typename decay_t<decltype(column)>::value_type;
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        static const char padding[SNAPSHOT_ALIGNMENT] = {};
+        out.write(padding, sections[index++].offset - position);
+        out.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+    });
+    out.close();
+    if (!out || rename(temp.c_str(), path.c_str()) != 0)
+    {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to check that the columns of a table agree with each other and with the row count
+bool checkTable(const MovieTable &table, uint64_t rows)
+{
+    bool valid = true;
+    auto checkNumeric = [&](size_t size)
+    {
+        valid = valid && size == rows;
+    };
+    // Every entry of a text or list column is read between two neighbouring offsets, so the offsets have to
+    // run from 0 to the end of the data without ever going back
+    auto checkOffsets = [&](const auto &offsets, uint64_t count, uint64_t end)
+    {
+        valid = valid && offsets.size() == count + 1 && offsets[0] == 0 && offsets.back() == end;
+        for (size_t i = 1; valid && i < offsets.size(); i++)
+        {
+            valid = offsets[i - 1] <= offsets[i];
+        }
+    };
+    auto checkText = [&](const StringColumn &text, uint64_t count)
+    {
+        checkOffsets(text.offsets, count, text.bytes.size());
+    };
+    checkNumeric(table.vote_average.size());
+    checkNumeric(table.vote_count.size());
+    checkNumeric(table.revenue.size());
+    checkNumeric(table.runtime.size());
+    checkNumeric(table.adult.size());
+    checkNumeric(table.budget.size());
+    checkNumeric(table.popularity.size());
+    checkNumeric(table.released.size());
+    for (const StringColumn *text : {&table.title, &table.status, &table.release_date, &table.original_title, &table.overview, &table.tagline})
+    {
+        checkText(*text, rows);
+    }
+    // Every category id has to fall inside its dictionary
+    auto checkIds = [&](const Column<uint32_t> &ids, const Dictionary &dictionary)
+    {
+        checkText(dictionary.values, dictionary.values.size());
+        for (size_t i = 0; valid && i < ids.size(); i++)
+        {
+            valid = ids[i] < dictionary.size();
+        }
+    };
+    checkNumeric(table.original_language.ids.size());
+    checkIds(table.original_language.ids, table.original_language.dictionary);
+    for (const ListColumn *list : {&table.genres, &table.production_companies, &table.production_countries, &table.spoken_languages})
+    {
+        checkOffsets(list->row_offsets, rows, list->ids.size());
+        checkIds(list->ids, list->dictionary);
+    }
+    for (const auto &bitmap : VALIDITY_BITMAPS)
+    {
+        valid = valid && (table.*bitmap.second).words.size() == (rows + 63) / 64;
+    }
+    return valid;
+}
+
+// Function to map a snapshot and point the table's columns into it.
+// Returns false if the snapshot is missing, damaged, or was built from a different CSV or parser setup
+bool loadSnapshot(const string &path, const SourceIdentity &source, uint64_t config_hash, MovieTable &table)
+{
+    auto file = make_shared<MappedFile>(path, MADV_WILLNEED);
+    if (!file->is_open())
+    {
+        return false;
+    }
+    string_view data = file->view();
+    SnapshotHeader header;
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.config_hash != config_hash || header.source_size != source.size ||
+        header.source_mtime_ns != source.mtime_ns || header.source_hash != source.hash)
+    {
+        return false;
+    }
+
+    MovieTable loaded;
+    size_t expected = 0;
+    forEachColumn(loaded, [&](auto &)
+    {
+        expected++;
+    });
+    if (header.sections != expected || data.size() < sizeof(header) + expected * sizeof(SnapshotSection))
+    {
+        return false;
+    }
+    vector<SnapshotSection> sections(expected);
+    memcpy(sections.data(), data.data() + sizeof(header), expected * sizeof(SnapshotSection));
+
+    bool valid = true;
+    size_t index = 0;
+    forEachColumn(loaded, [&](auto &column)
+    {
+        using T = typename decay_t<decltype(column)>::value_type;
+        const SnapshotSection &section = sections[index++];
+        if (!valid || section.offset % alignof(T) != 0 || section.offset > data.size() ||
+            section.count > (data.size() - section.offset) / sizeof(T))
+        {
+            valid = false;
+            return;
+        }
+        column.borrow(reinterpret_cast<const T *>(data.data() + section.offset), section.count);
+    });
+    for (const auto &bitmap : VALIDITY_BITMAPS)
+    {
+        (loaded.*bitmap.second).setSize(header.rows);
+    }
+    if (!valid || !checkTable(loaded, header.rows))
+    {
+        return false;
+    }
+
+    loaded.mapping = file;
+    loaded.rows = header.rows;
+    table = move(loaded);
+    return true;
+}
+
+// Ranges shorter than this are sorted by insertion, and splits stop forking tasks below the grain
+const size_t INSERTION_SORT_LIMIT = 32;
+const size_t PARALLEL_SORT_GRAIN = 1 << 13;
+
+// Function to sort a short range by insertion. Items only move past items they belong in front of,
+// so equal items keep their order
+template <typename T, typename Before>
+void insertionSort(T *first, size_t n, Before before)
+{
+    for (size_t i = 1; i < n; i++)
+    {
+        T item = move(first[i]);
+        size_t j = i;
+        while (j > 0 && before(item, first[j - 1]))
+        {
+            first[j] = move(first[j - 1]);
+            j--;
+        }
+        first[j] = move(item);
+    }
+}
+
+// Function to merge two sorted ranges into out. An item of b goes first only if it belongs in
+// front of the item of a, so on ties the left range wins and the merge is stable
+template <typename T, typename Before>
+void mergeRanges(T *a, size_t na, T *b, size_t nb, T *out, Before before)
+{
+    size_t i = 0, j = 0;
+    while (i < na && j < nb)
+    {
+        if (before(b[j], a[i]))
+        {
+            *out++ = move(b[j++]);
+        }
+        else
+        {
+            *out++ = move(a[i++]);
+        }
+    }
+    out = move(a + i, a + na, out);
+    move(b + j, b + nb, out);
+}
+
+// Function to merge two sorted ranges on the pool. The longer range is cut at its middle item and
+// the other at the first item that does not sort before it (or, cut in b, after the last item of a
+// that does not sort after it), which keeps ties in order. Both halves are then merged independently
+template <typename T, typename Before>
+void parallelMerge(T *a, size_t na, T *b, size_t nb, T *out, Before before, WorkStealingPool &pool)
+{
+    if (na + nb <= PARALLEL_SORT_GRAIN)
+    {
+        mergeRanges(a, na, b, nb, out, before);
+        return;
+    }
+    size_t i, j;
+    if (na >= nb)
+    {
+        i = na / 2;
+        j = partition_point(b, b + nb, [&](const T &item)
+                            { return before(item, a[i]); }) -
+            b;
+    }
+    else
+    {
+        j = nb / 2;
+        i = partition_point(a, a + na, [&](const T &item)
+                            { return !before(b[j], item); }) -
+            a;
+    }
+    WorkStealingPool::TaskGroup group;
+    pool.spawn(group, [=, &pool]()
+               { parallelMerge(a, i, b, j, out, before, pool); });
+    parallelMerge(a + i, na - i, b + j, nb - j, out + i + j, before, pool);
+    pool.wait(group);
+}
+
+// Function to sort [first, first + n) and leave the result in first, or in scratch if into_scratch
+// is set. The halves are sorted into the other buffer and merged back, so the two buffers trade
+// places on every level and no level allocates. Without a pool, or with a pool of one thread, the
+// sort runs on the calling thread
+template <typename T, typename Before>
+void sortInto(T *first, T *scratch, size_t n, bool into_scratch, Before before, WorkStealingPool *pool)
+{
+    if (n <= INSERTION_SORT_LIMIT)
+    {
+        insertionSort(first, n, before);
+        if (into_scratch)
+        {
+            move(first, first + n, scratch);
+        }
+        return;
+    }
+    size_t half = n / 2;
+    bool parallel = pool != nullptr && pool->size() > 1;
+    if (parallel && n > PARALLEL_SORT_GRAIN)
+    {
+        WorkStealingPool::TaskGroup group;
+        pool->spawn(group, [=]()
+                    { sortInto(first, scratch, half, !into_scratch, before, pool); });
+        sortInto(first + half, scratch + half, n - half, !into_scratch, before, pool);
+        pool->wait(group);
+    }
+    else
+    {
+        sortInto(first, scratch, half, !into_scratch, before, pool);
+        sortInto(first + half, scratch + half, n - half, !into_scratch, before, pool);
+    }
+    T *from = into_scratch ? first : scratch;
+    T *to = into_scratch ? scratch : first;
+    if (parallel)
+    {
+        parallelMerge(from, half, from + half, n - half, to, before, *pool);
+    }
+    else
+    {
+        mergeRanges(from, half, from + half, n - half, to, before);
+    }
+}
+
+// Function to sort a range stably, on the pool if one is given; before(x, y) tells whether x belongs in
+// front of y. One scratch buffer as long as the range serves every merge
+template <typename T, typename Before>
+void parallelMergeSort(T *first, T *last, Before before, WorkStealingPool *pool = nullptr)
+{
+    size_t n = last - first;
+    if (n < 2)
+    {
+        return;
+    }
+    vector<T> scratch(n);
+    sortInto(first, scratch.data(), n, false, before, pool);
+}
+
+// Sort record for permutation sorting: the sort key of an item next to the item's index.
+// With 8-byte keys a record is 16 bytes, so the sort never copies whole movies or companies
+template <typename K>
+struct KeyedRow
+{
+    K key;
+    uint64_t row;
+};
+
+// Ranges at least this long are radix sorted when the key is a number
+const size_t RADIX_SORT_MIN = 256;
+
+// Function to map a number onto an unsigned integer of the same width with the same order.
+// Signed integers flip the sign bit. IEEE floats flip the sign bit of positives and every bit of
+// negatives, and -0.0 is read as 0.0 so that the two compare equal like they do with >
+template <typename K>
+auto radixKey(K key)
+{
+    if constexpr (is_floating_point_v<K>)
+    {
+        using Bits = conditional_t<sizeof(K) == 4, uint32_t, uint64_t>;
+        if (key == 0)
+        {
+            key = 0;
+        }
+        Bits bits;
+        memcpy(&bits, &key, sizeof(bits));
+        const Bits sign = Bits(1) << (sizeof(Bits) * 8 - 1);
+        return (bits & sign) ? Bits(~bits) : Bits(bits | sign);
+    }
+    else
+    {
+        using Bits = make_unsigned_t<K>;
+        Bits bits = static_cast<Bits>(key);
+        if constexpr (is_signed_v<K>)
+        {
+            bits ^= Bits(1) << (sizeof(Bits) * 8 - 1);
+        }
+        return bits;
+    }
+}
+
+// Function to sort keyed rows by key with an LSD radix sort, one pass per key byte. For a descending
+// order the mapped keys are inverted, and a pass where every key has the same byte is skipped.
+// Each pass is stable, so on equal keys the record that came first stays first
+template <typename Order, typename K>
+void radixSortKeyedRows(KeyedRow<K> *items, size_t n)
+{
+    using Bits = decltype(radixKey(K()));
+    auto sortKey = [](K key)
+    {
+        Bits bits = radixKey(key);
+        return Order::descending ? Bits(~bits) : bits;
+    };
+    const size_t bytes = sizeof(Bits);
+    vector<array<size_t, 256>> counts(bytes);
+    for (size_t i = 0; i < n; i++)
+    {
+        Bits key = sortKey(items[i].key);
+        for (size_t b = 0; b < bytes; b++)
+        {
+            counts[b][(key >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    vector<KeyedRow<K>> scratch(n);
+    KeyedRow<K> *from = items;
+    KeyedRow<K> *to = scratch.data();
+    for (size_t b = 0; b < bytes; b++)
+    {
+        array<size_t, 256> &count = counts[b];
+        if (*max_element(count.begin(), count.end()) == n)
+        {
+            continue;
+        }
+        size_t offset = 0;
+        for (size_t &bucket : count)
+        {
+            size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            Bits key = sortKey(from[i].key);
+            to[count[(key >> (b * 8)) & 0xff]++] = from[i];
+        }
+        swap(from, to);
+    }
+    if (from != items)
+    {
+        copy(from, from + n, items);
+    }
+}
+
+// Ordering policies of sortByKey: before(a, b) tells whether key a belongs in front of key b
+struct Ascending
+{
+    static constexpr bool descending = false;
+
+    template <typename K>
+    static bool before(const K &a, const K &b)
+    {
+        return a < b;
+    }
+};
+
+struct Descending
+{
+    static constexpr bool descending = true;
+
+    template <typename K>
+    static bool before(const K &a, const K &b)
+    {
+        return a > b;
+    }
+};
+
+// Key extractors of sortByKey: the item itself, or one of its members
+struct Identity
+{
+    template <typename T>
+    const T &operator()(const T &item) const
+    {
+        return item;
+    }
+};
+
+template <auto Member>
+struct ByMember
+{
+    template <typename T>
+    const auto &operator()(const T &item) const
+    {
+        return item.*Member;
+    }
+};
+
+// Function to sort a range stably by the key Key extracts, in the order of Order. Both are types,
+// so each use compiles to its own sort with the comparison inlined. A numeric key on a long range
+// is radix sorted as (key, index) records and every item moved into place once, a range of keyed
+// rows is radix sorted directly, and everything else is merge sorted
+template <typename Key, typename Order, typename T>
+void sortByKey(T *first, T *last, WorkStealingPool *pool = nullptr)
+{
+    using K = decay_t<decltype(Key()(*first))>;
+    size_t n = last - first;
+    if constexpr (is_arithmetic_v<K>)
+    {
+        if (n >= RADIX_SORT_MIN)
+        {
+            if constexpr (is_same_v<T, KeyedRow<K>> && is_same_v<Key, ByMember<&KeyedRow<K>::key>>)
+            {
+                radixSortKeyedRows<Order>(first, n);
+            }
+            else
+            {
+                vector<KeyedRow<K>> items(n);
+                for (size_t i = 0; i < n; i++)
+                {
+                    items[i] = {Key()(first[i]), i};
+                }
+                radixSortKeyedRows<Order>(items.data(), n);
+
+                vector<T> sorted;
+                sorted.reserve(n);
+                for (const KeyedRow<K> &item : items)
+                {
+                    sorted.push_back(move(first[item.row]));
+                }
+                move(sorted.begin(), sorted.end(), first);
+            }
+            return;
+        }
+    }
+    parallelMergeSort(first, last, [](const T &a, const T &b)
+                      { return Order::before(Key()(a), Key()(b)); }, pool);
+}
+
+template <typename Key, typename Order, typename T>
+void sortByKey(vector<T> &items, WorkStealingPool *pool = nullptr)
+{
+    sortByKey<Key, Order>(items.data(), items.data() + items.size(), pool);
+}
+
+// Extractors of the key of a keyed row and of the count of a word
+template <typename K>
+using RowKey = ByMember<&KeyedRow<K>::key>;
+using ByFrequency = ByMember<&WordFrequency::frequency>;
+
+// Function to reorder a view by a column of its table, highest value first
+template <auto Member>
+TableView sortViewByColumn(const TableView &view, WorkStealingPool *pool = nullptr)
+{
+    const auto &column = view.table().*Member;
+    using K = decay_t<decltype(column[0])>;
+    vector<KeyedRow<K>> items(view.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        items[i] = {column[view.row(i)], view.row(i)};
+    }
+    sortByKey<RowKey<K>, Descending>(items, pool);
+
+    vector<uint64_t> rows(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        rows[i] = items[i].row;
+    }
+    return TableView(view.table(), move(rows));
+}
+
+// Function to order companies by total revenue, highest first.
+// Returns the company indices in sorted order and leaves the vector itself untouched
+vector<uint64_t> mergeSortCompanies(const vector<CompanyInfo> &companies, WorkStealingPool *pool = nullptr)
+{
+    vector<KeyedRow<long long>> items(companies.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        items[i] = {companies[i].totalRevenue, i};
+    }
+    sortByKey<RowKey<long long>, Descending>(items, pool);
+
+    vector<uint64_t> order(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+    {
+        order[i] = items[i].row;
+    }
+    return order;
+}
+
+// Function to select the k best of n items, best first, with a bounded heap in O(n log k).
+// better(a, b) compares item indices; items it cannot tell apart keep their index order,
+// so the result is exactly the first k entries of a stable sort
+template <typename Better>
+vector<uint64_t> topK(size_t n, size_t k, Better better)
+{
+    // ranksAbove is the heap's "less than", which keeps the weakest kept item at the front
+    auto ranksAbove = [&](uint64_t a, uint64_t b)
+    {
+        if (better(a, b))
+            return true;
+        if (better(b, a))
+            return false;
+        return a < b;
+    };
+    vector<uint64_t> heap;
+    heap.reserve(min(n, k));
+    for (uint64_t i = 0; i < n && k > 0; i++)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(i);
+            push_heap(heap.begin(), heap.end(), ranksAbove);
+        }
+        else if (ranksAbove(i, heap.front()))
+        {
+            pop_heap(heap.begin(), heap.end(), ranksAbove);
+            heap.back() = i;
+            push_heap(heap.begin(), heap.end(), ranksAbove);
+        }
+    }
+    sort_heap(heap.begin(), heap.end(), ranksAbove);
+    return heap;
+}
+
+// Function to find the k movies with the highest revenue
+TableView topMoviesByRevenue(const MovieTable &table, size_t k)
+{
+    vector<uint64_t> rows = topK(table.size(), k, [&](uint64_t a, uint64_t b)
+                                 { return table.revenue[a] > table.revenue[b]; });
+    return TableView(table, move(rows));
+}
+
+// Function to find the k most popular movies. Equal popularity falls back to revenue,
+// the order the popularity ranking has always been taken from
+TableView topMoviesByPopularity(const MovieTable &table, size_t k)
+{
+    vector<uint64_t> rows = topK(table.size(), k, [&](uint64_t a, uint64_t b)
+                                 {
+                                     if (table.popularity[a] != table.popularity[b])
+                                         return table.popularity[a] > table.popularity[b];
+                                     return table.revenue[a] > table.revenue[b]; });
+    return TableView(table, move(rows));
+}
+
+// Function to find the k companies with the highest total revenue
+vector<uint64_t> topCompaniesByRevenue(const vector<CompanyInfo> &companies, size_t k)
+{
+    return topK(companies.size(), k, [&](uint64_t a, uint64_t b)
+                { return companies[a].totalRevenue > companies[b].totalRevenue; });
+}
+
+// Function to find the k most frequent words
+vector<uint64_t> topWords(const vector<WordFrequency> &wordFreq, size_t k)
+{
+    return topK(wordFreq.size(), k, [&](uint64_t a, uint64_t b)
+                { return wordFreq[a].frequency > wordFreq[b].frequency; });
+}
+
+// Binary search to check if a string exists in a sorted vector of strings
+bool binarySearch(const vector<string> &arr, const string &target)
+{
+    int left = 0;
+    int right = arr.size() - 1;
+
+    while (left <= right)
+    {
+        int mid = left + (right - left) / 2;
+
+        // Check if the middle element is the target
+        if (arr[mid] == target)
+        {
+            return true;
+        }
+        // If target is greater, ignore left half
+        else if (arr[mid] < target)
+        {
+            left = mid + 1;
+        }
+        // If target is smaller, ignore right half
+        else
+        {
+            right = mid - 1;
+        }
+    }
+    // If not found, return false
+    return false;
+}
+
+// Function to insert a string into the bucket at the appropriate position
+void insertSort(vector<string> &bucket, string &val)
+{
+    auto it = bucket.begin();
+    while (it != bucket.end() && *it < val)
+    {
+        ++it;
+    }
+    bucket.insert(it, val);
+}
+
+// Bucket sort for lowercase words
+void bucketSort(vector<string> &words)
+{
+    vector<vector<string>> buckets(26); // Assuming only lowercase words
+
+    // Distribute words into buckets based on their first character
+    for (string &word : words)
+    {
+        int bucketIndex = word[0] - 'a';
+        insertSort(buckets[bucketIndex], word);
+    }
+
+    // Concatenate the buckets back into the original array
+    int index = 0;
+    for (auto &bucket : buckets)
+    {
+        for (string &word : bucket)
+        {
+            words[index++] = word;
+        }
+    }
+}
+
+// Attributes a query can group movies by. With the list keys a movie falls in the group of every entry of its list
+enum class GroupKey
+{
+    Language,
+    Year,
+    Country,
+    Company,
+    Genre
+};
+
+// Numeric column read by an aggregate, None for a plain count
+enum class Measure
+{
+    None,
+    VoteAverage,
+    VoteCount,
+    Revenue,
+    Runtime,
+    Budget,
+    Popularity
+};
+
+enum class AggregateOp
+{
+    Count,
+    Sum,
+    Avg,
+    Min,
+    Max
+};
+
+// One aggregate of a query, such as {AggregateOp::Sum, Measure::Revenue}
+struct QueryAggregate
+{
+    AggregateOp op;
+    Measure measure;
+};
+
+// Function to call visit with the column of a measure
+template <typename Visitor>
+void withMeasure(const MovieTable &table, Measure measure, Visitor &&visit)
+{
+    switch (measure)
+    {
+    case Measure::VoteAverage:
+        visit(table.vote_average);
+        break;
+    case Measure::VoteCount:
+        visit(table.vote_count);
+        break;
+    case Measure::Revenue:
+        visit(table.revenue);
+        break;
+    case Measure::Runtime:
+        visit(table.runtime);
+        break;
+    case Measure::Budget:
+        visit(table.budget);
+        break;
+    case Measure::Popularity:
+        visit(table.popularity);
+        break;
+    case Measure::None:
+        break;
+    }
+}
+
+// Function to tell whether a measure is an integer column
+bool integerMeasure(Measure measure)
+{
+    return measure == Measure::VoteCount || measure == Measure::Revenue || measure == Measure::Runtime ||
+           measure == Measure::Budget;
+}
+
+// Function to tell whether an aggregate has an exact integer value: counts, and the sums, minima and maxima of integer columns
+bool integerAggregate(const QueryAggregate &aggregate)
+{
+    return aggregate.op == AggregateOp::Count || (aggregate.op != AggregateOp::Avg && integerMeasure(aggregate.measure));
+}
+
+// Running state of one aggregate in one group. Integer columns fold into the 64-bit fields and stay exact,
+// float columns into the double fields. An average is read as sum / count, so states merge exactly
+struct GroupState
+{
+    long long count = 0;
+    long long integer_sum = 0;
+    long long integer_min = numeric_limits<long long>::max();
+    long long integer_max = numeric_limits<long long>::min();
+    double sum = 0;
+    double min = numeric_limits<double>::infinity();
+    double max = -numeric_limits<double>::infinity();
+
+    // Function to fold in the state of the same aggregate over other rows
+    void merge(const GroupState &other)
+    {
+        count += other.count;
+        integer_sum += other.integer_sum;
+        integer_min = std::min(integer_min, other.integer_min);
+        integer_max = std::max(integer_max, other.integer_max);
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+// Function to read the final value of an aggregate
+double aggregateValue(const QueryAggregate &aggregate, const GroupState &state)
+{
+    bool integer = integerMeasure(aggregate.measure);
+    switch (aggregate.op)
+    {
+    case AggregateOp::Count:
+        return static_cast<double>(state.count);
+    case AggregateOp::Sum:
+        return integer ? static_cast<double>(state.integer_sum) : state.sum;
+    case AggregateOp::Avg:
+        return state.count == 0 ? 0 : (integer ? static_cast<double>(state.integer_sum) : state.sum) / state.count;
+    case AggregateOp::Min:
+        return integer ? static_cast<double>(state.integer_min) : state.min;
+    case AggregateOp::Max:
+        return integer ? static_cast<double>(state.integer_max) : state.max;
+    }
+    return 0;
+}
+
+// Function to read the exact value of an integer aggregate, see integerAggregate
+long long aggregateInteger(const QueryAggregate &aggregate, const GroupState &state)
+{
+    switch (aggregate.op)
+    {
+    case AggregateOp::Count:
+        return state.count;
+    case AggregateOp::Sum:
+        return state.integer_sum;
+    case AggregateOp::Min:
+        return state.integer_min;
+    case AggregateOp::Max:
+        return state.integer_max;
+    case AggregateOp::Avg:
+        break;
+    }
+    return static_cast<long long>(aggregateValue(aggregate, state));
+}
+
+// Result of a query: one row per group in order of first appearance, with the running state of every aggregate
+class QueryResult
+{
+public:
+    vector<string> groups;             // Label of every group
+    vector<QueryAggregate> aggregates; // Aggregates of the query
+    vector<vector<GroupState>> states; // states[a][g] is the state of aggregate a in group g
+
+    size_t size() const { return groups.size(); }
+    double value(size_t group, size_t aggregate = 0) const { return aggregateValue(aggregates[aggregate], states[aggregate][group]); }
+    long long integerValue(size_t group, size_t aggregate = 0) const { return aggregateInteger(aggregates[aggregate], states[aggregate][group]); }
+
+    // Function to order the groups by an aggregate, highest first unless ascending. Equal values keep their order.
+    // Integer aggregates are compared exactly
+    void sortBy(size_t aggregate, bool ascending = false)
+    {
+        if (integerAggregate(aggregates[aggregate]))
+        {
+            vector<KeyedRow<long long>> items(size());
+            for (size_t g = 0; g < items.size(); g++)
+            {
+                items[g] = {integerValue(g, aggregate), g};
+            }
+            sortItems(items, ascending);
+        }
+        else
+        {
+            vector<KeyedRow<double>> items(size());
+            for (size_t g = 0; g < items.size(); g++)
+            {
+                items[g] = {value(g, aggregate), g};
+            }
+            sortItems(items, ascending);
+        }
+    }
+
+    // Function to order the groups alphabetically by label
+    void sortByGroup()
+    {
+        vector<uint64_t> order(size());
+        for (size_t g = 0; g < order.size(); g++)
+        {
+            order[g] = g;
+        }
+        stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b)
+        {
+            return groups[a] < groups[b];
+        });
+        reorder(order);
+    }
+
+    // Function to fold in the result of the same query over other rows; groups new to this result go at the
+    // end. Every aggregate merges exactly, averages included
+    void merge(const QueryResult &other)
+    {
+        // An empty result, such as a fresh state, takes on the aggregates of other
+        if (states.empty())
+        {
+            aggregates = other.aggregates;
+            states.resize(other.states.size(), vector<GroupState>(groups.size()));
+        }
+        Dictionary labels;
+        for (const string &group : groups)
+        {
+            labels.intern(group);
+        }
+        for (size_t g = 0; g < other.size(); g++)
+        {
+            uint32_t target = labels.intern(other.groups[g]);
+            if (target == groups.size())
+            {
+                groups.push_back(other.groups[g]);
+                for (size_t a = 0; a < states.size(); a++)
+                {
+                    states[a].push_back(other.states[a][g]);
+                }
+                continue;
+            }
+            for (size_t a = 0; a < states.size(); a++)
+            {
+                states[a][target].merge(other.states[a][g]);
+            }
+        }
+    }
+
+private:
+    template <typename K>
+    void sortItems(vector<KeyedRow<K>> &items, bool ascending)
+    {
+        if (ascending)
+        {
+            sortByKey<RowKey<K>, Ascending>(items);
+        }
+        else
+        {
+            sortByKey<RowKey<K>, Descending>(items);
+        }
+        vector<uint64_t> order(items.size());
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            order[i] = items[i].row;
+        }
+        reorder(order);
+    }
+
+    void reorder(const vector<uint64_t> &order)
+    {
+        vector<string> sortedGroups;
+        sortedGroups.reserve(order.size());
+        for (uint64_t g : order)
+        {
+            sortedGroups.push_back(move(groups[g]));
+        }
+        groups = move(sortedGroups);
+        for (vector<GroupState> &column : states)
+        {
+            vector<GroupState> sortedColumn(order.size());
+            for (size_t i = 0; i < order.size(); i++)
+            {
+                sortedColumn[i] = column[order[i]];
+            }
+            column = move(sortedColumn);
+        }
+    }
+};
+
+// Rows handled per batch: the group of every (row, group) pair of a batch is resolved first,
+// then every aggregate folds its column over the whole batch in one tight loop
+const size_t QUERY_BATCH_ROWS = 1024;
+
+// Function to fold one column over a batch of (row, group) pairs
+template <typename T>
+void foldBatch(AggregateOp op, const Column<T> &column, const vector<uint64_t> &rows, const vector<uint32_t> &groups, vector<GroupState> &states)
+{
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        GroupState &state = states[groups[i]];
+        T value = column[rows[i]];
+        state.count++;
+        if constexpr (is_integral<T>::value)
+        {
+            if (op == AggregateOp::Min)
+            {
+                state.integer_min = min<long long>(state.integer_min, value);
+            }
+            else if (op == AggregateOp::Max)
+            {
+                state.integer_max = max<long long>(state.integer_max, value);
+            }
+            else
+            {
+                state.integer_sum += value;
+            }
+        }
+        else if (op == AggregateOp::Min)
+        {
+            state.min = min(state.min, static_cast<double>(value));
+        }
+        else if (op == AggregateOp::Max)
+        {
+            state.max = max(state.max, static_cast<double>(value));
+        }
+        else
+        {
+            state.sum += value;
+        }
+    }
+}
+
+// Function to group the movies by a key and compute the aggregates of every group, e.g.
+// groupBy(table, GroupKey::Country, {{AggregateOp::Sum, Measure::Revenue}}) for the revenue of each country.
+// Groups come out in order of first appearance; sort the result with sortBy or sortByGroup
+QueryResult groupBy(const MovieTable &table, GroupKey key, const vector<QueryAggregate> &aggregates)
+{
+    // Every key value gets a label id. Single-valued keys give each row one label (or none), list keys
+    // give each entry of a list dictionary its labels, more than one when an entry holds several genres
+    const uint32_t NO_LABEL = numeric_limits<uint32_t>::max();
+    vector<string> labels;
+    vector<uint32_t> rowLabel;
+    const ListColumn *list = nullptr;
+    vector<vector<uint32_t>> entryLabels;
+    switch (key)
+    {
+    case GroupKey::Language:
+    {
+        const CategoryColumn &languages = table.original_language;
+        for (uint32_t id = 0; id < languages.dictionary.size(); id++)
+        {
+            labels.emplace_back(languages.dictionary[id]);
+        }
+        rowLabel.assign(languages.ids.begin(), languages.ids.end());
+        break;
+    }
+    case GroupKey::Year:
+    {
+        HashAggregator<int, CountAggregate> years;
+        rowLabel.assign(table.size(), NO_LABEL);
+        for (size_t row = 0; row < table.size(); row++)
+        {
+            if (table.released[row] != 0)
+            {
+                bool inserted;
+                int year = releaseYear(table.released[row]);
+                rowLabel[row] = static_cast<uint32_t>(years.group(year, inserted));
+                if (inserted)
+                {
+                    labels.push_back(to_string(year));
+                }
+            }
+        }
+        break;
+    }
+    case GroupKey::Country:
+    case GroupKey::Company:
+    {
+        list = (key == GroupKey::Country) ? &table.production_countries : &table.production_companies;
+        for (uint32_t id = 0; id < list->dictionary.size(); id++)
+        {
+            labels.emplace_back(list->dictionary[id]);
+            entryLabels.push_back({id});
+        }
+        break;
+    }
+    case GroupKey::Genre:
+    {
+        // A genre entry is a comma separated list of genres
+        list = &table.genres;
+        Dictionary genres;
+        for (uint32_t id = 0; id < list->dictionary.size(); id++)
+        {
+            entryLabels.emplace_back();
+            stringstream ss{string(list->dictionary[id])};
+            string genre;
+            while (getline(ss, genre, ','))
+            {
+                uint32_t label = genres.intern(trim(genre));
+                if (label == labels.size())
+                {
+                    labels.emplace_back(genres[label]);
+                }
+                entryLabels.back().push_back(label);
+            }
+        }
+        break;
+    }
+    }
+
+    QueryResult result;
+    result.aggregates = aggregates;
+    vector<int32_t> labelGroup(labels.size(), -1);
+    vector<vector<GroupState>> &states = result.states;
+    states.resize(aggregates.size());
+    vector<uint64_t> batchRows;
+    vector<uint32_t> batchGroups;
+    auto emit = [&](uint64_t row, uint32_t label)
+    {
+        if (labelGroup[label] < 0)
+        {
+            labelGroup[label] = static_cast<int32_t>(result.groups.size());
+            result.groups.push_back(labels[label]);
+            for (vector<GroupState> &aggregateStates : states)
+            {
+                aggregateStates.emplace_back();
+            }
+        }
+        batchRows.push_back(row);
+        batchGroups.push_back(static_cast<uint32_t>(labelGroup[label]));
+    };
+
+    for (size_t begin = 0; begin < table.size(); begin += QUERY_BATCH_ROWS)
+    {
+        size_t end = min(table.size(), begin + QUERY_BATCH_ROWS);
+        batchRows.clear();
+        batchGroups.clear();
+        for (size_t row = begin; row < end; row++)
+        {
+            if (list != nullptr)
+            {
+                for (size_t j = list->first(row); j < list->last(row); j++)
+                {
+                    for (uint32_t label : entryLabels[list->id(j)])
+                    {
+                        emit(row, label);
+                    }
+                }
+            }
+            else if (rowLabel[row] != NO_LABEL)
+            {
+                emit(row, rowLabel[row]);
+            }
+        }
+
+        for (size_t a = 0; a < aggregates.size(); a++)
+        {
+            if (aggregates[a].op == AggregateOp::Count || aggregates[a].measure == Measure::None)
+            {
+                for (uint32_t group : batchGroups)
+                {
+                    states[a][group].count++;
+                }
+                continue;
+            }
+            withMeasure(table, aggregates[a].measure, [&](const auto &column)
+            {
+                foldBatch(aggregates[a].op, column, batchRows, batchGroups, states[a]);
+            });
+        }
+    }
+    return result;
+}
+
+// Per-country totals the country reports are answered from
+enum CountryTotal
+{
+    COUNTRY_REVENUE,
+    COUNTRY_RATING,
+    COUNTRY_POPULARITY,
+    COUNTRY_MOVIES
+};
+
+const vector<QueryAggregate> COUNTRY_TOTALS = {
+    {AggregateOp::Sum, Measure::Revenue},
+    {AggregateOp::Sum, Measure::VoteAverage},
+    {AggregateOp::Sum, Measure::Popularity},
+    {AggregateOp::Count, Measure::None}};
+
+// Function to find the country with the highest value of one of the country totals
+string findCountryWithHighestProperty(QueryResult countries, CountryTotal total)
+{
+    countries.sortBy(total);
+    return countries.size() == 0 ? "" : countries.groups[0];
+}
+
+// Function to find the country with the most number of movies
+string findMostProducingCountry(const QueryResult &countries)
+{
+    return findCountryWithHighestProperty(countries, COUNTRY_MOVIES);
+}
+
+vector<CompanyInfo> processCompanyInfo(const MovieTable &table)
+{
+    // Groups are in order of first appearance, so group g is companies[g]
+    QueryResult revenue = groupBy(table, GroupKey::Company, {{AggregateOp::Sum, Measure::Revenue}});
+    vector<CompanyInfo> companies(revenue.size());
+    for (size_t g = 0; g < companies.size(); g++)
+    {
+        companies[g].name = revenue.groups[g];
+        companies[g].totalRevenue = revenue.integerValue(g);
+    }
+
+    const ListColumn &productionCompanies = table.production_companies;
+    const ListColumn &countries = table.production_countries;
+    vector<int32_t> companyIndex(productionCompanies.dictionary.size(), -1);
+    // (company id, country id) pairs already listed in producedCountries
+    HashAggregator<uint64_t, CountAggregate> producedPairs;
+    int32_t seen = 0;
+    for (size_t row = 0; row < table.size(); row++)
+    {
+        for (size_t c = productionCompanies.first(row); c < productionCompanies.last(row); c++)
+        {
+            uint32_t company = productionCompanies.id(c);
+            bool inserted;
+            if (companyIndex[company] < 0)
+            {
+                // A new company takes the country list of its first movie as it is
+                companyIndex[company] = seen++;
+                for (size_t j = countries.first(row); j < countries.last(row); j++)
+                {
+                    companies[companyIndex[company]].producedCountries.emplace_back(countries.value(j));
+                    producedPairs.group(static_cast<uint64_t>(company) << 32 | countries.id(j), inserted);
+                }
+                continue;
+            }
+
+            for (size_t j = countries.first(row); j < countries.last(row); j++)
+            {
+                producedPairs.group(static_cast<uint64_t>(company) << 32 | countries.id(j), inserted);
+                if (inserted)
+                {
+                    companies[companyIndex[company]].producedCountries.emplace_back(countries.value(j));
+                }
+            }
+        }
+    }
+    return companies;
+}
+
+// Statistics kernels. Every kernel has a scalar version and, on x86, SSE2, AVX2 and AVX-512 versions;
+// statKernels() picks the widest set the CPU reports through CPUID the first time it is called
+struct StatKernels
+{
+    const char *name;
+    double (*sum)(const double *values, size_t n);
+    double (*dot)(const double *x, const double *y, size_t n);
+    void (*minMax)(const int *values, size_t n, int &low, int &high);
+    void (*histogram)(const int *values, size_t n, int base, uint32_t *counts, size_t buckets);
+};
+
+// Function to add up n doubles
+double sumScalar(const double *values, size_t n)
+{
+    double total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        total += values[i];
+    }
+    return total;
+}
+
+// Function to compute the dot product of two arrays of n doubles
+double dotScalar(const double *x, const double *y, size_t n)
+{
+    double total = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        total += x[i] * y[i];
+    }
+    return total;
+}
+
+// Function to find the smallest and largest of n ints, n must not be 0
+void minMaxScalar(const int *values, size_t n, int &low, int &high)
+{
+    low = high = values[0];
+    for (size_t i = 1; i < n; i++)
+    {
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+    }
+}
+
+// Function to count every value into counts[value - base]; all values must fall inside the buckets counts
+void histogramScalar(const int *values, size_t n, int base, uint32_t *counts, size_t buckets)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        counts[values[i] - base]++;
+    }
+}
+
+// Count tables of the SSE2 and AVX2 histograms, which have no scatter: vector lane k counts into table
+// k % HISTOGRAM_TABLES. Runtimes cluster, so neighbouring values often hit the same counter, and with one
+// table every increment would wait for the one before it
+const size_t HISTOGRAM_TABLES = 4;
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS 1
+
+__attribute__((target("sse2"))) double sumSSE2(const double *values, size_t n)
+{
+    __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        a = _mm_add_pd(a, _mm_loadu_pd(values + i));
+        b = _mm_add_pd(b, _mm_loadu_pd(values + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(a, b));
+    return lanes[0] + lanes[1] + sumScalar(values + i, n - i);
+}
+
+__attribute__((target("sse2"))) double dotSSE2(const double *x, const double *y, size_t n)
+{
+    __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        a = _mm_add_pd(a, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        b = _mm_add_pd(b, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(a, b));
+    return lanes[0] + lanes[1] + dotScalar(x + i, y + i, n - i);
+}
+
+// SSE2 has no 32-bit integer min/max, so both are built from a compare and a bitwise select
+__attribute__((target("sse2"))) void minMaxSSE2(const int *values, size_t n, int &low, int &high)
+{
+    if (n < 4)
+    {
+        minMaxScalar(values, n, low, high);
+        return;
+    }
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values));
+    __m128i hi = lo;
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+        __m128i less = _mm_cmplt_epi32(v, lo);
+        __m128i greater = _mm_cmpgt_epi32(v, hi);
+        lo = _mm_or_si128(_mm_and_si128(less, v), _mm_andnot_si128(less, lo));
+        hi = _mm_or_si128(_mm_and_si128(greater, v), _mm_andnot_si128(greater, hi));
+    }
+    int lanes_lo[4], lanes_hi[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes_lo), lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes_hi), hi);
+    minMaxScalar(lanes_lo, 4, low, high);
+    int unused;
+    minMaxScalar(lanes_hi, 4, unused, high);
+    for (; i < n; i++)
+    {
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+    }
+}
+
+__attribute__((target("sse2"))) void histogramSSE2(const int *values, size_t n, int base, uint32_t *counts, size_t buckets)
+{
+    // The extra tables only pay off when there are more values than counters to clear and add up
+    if (n < HISTOGRAM_TABLES * buckets)
+    {
+        histogramScalar(values, n, base, counts, buckets);
+        return;
+    }
+    vector<uint32_t> tables(HISTOGRAM_TABLES * buckets);
+    uint32_t *table0 = tables.data(), *table1 = table0 + buckets, *table2 = table1 + buckets, *table3 = table2 + buckets;
+    __m128i offset = _mm_set1_epi32(base);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i index = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i)), offset);
+        table0[_mm_cvtsi128_si32(index)]++;
+        table1[_mm_cvtsi128_si32(_mm_srli_si128(index, 4))]++;
+        table2[_mm_cvtsi128_si32(_mm_srli_si128(index, 8))]++;
+        table3[_mm_cvtsi128_si32(_mm_srli_si128(index, 12))]++;
+    }
+    histogramScalar(values + i, n - i, base, counts, buckets);
+    size_t b = 0;
+    for (; b + 4 <= buckets; b += 4)
+    {
+        __m128i total = _mm_loadu_si128(reinterpret_cast<const __m128i *>(counts + b));
+        for (size_t table = 0; table < HISTOGRAM_TABLES; table++)
+        {
+            total = _mm_add_epi32(total, _mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.data() + table * buckets + b)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(counts + b), total);
+    }
+    for (; b < buckets; b++)
+    {
+        for (size_t table = 0; table < HISTOGRAM_TABLES; table++)
+        {
+            counts[b] += tables[table * buckets + b];
+        }
+    }
+}
+
+__attribute__((target("avx2"))) double sumAVX2(const double *values, size_t n)
+{
+    __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        a = _mm256_add_pd(a, _mm256_loadu_pd(values + i));
+        b = _mm256_add_pd(b, _mm256_loadu_pd(values + i + 4));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(a, b));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumScalar(values + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) double dotAVX2(const double *x, const double *y, size_t n)
+{
+    __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        a = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), a);
+        b = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), b);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(a, b));
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotScalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2"))) void minMaxAVX2(const int *values, size_t n, int &low, int &high)
+{
+    if (n < 8)
+    {
+        minMaxScalar(values, n, low, high);
+        return;
+    }
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+    __m256i hi = lo;
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        lo = _mm256_min_epi32(lo, v);
+        hi = _mm256_max_epi32(hi, v);
+    }
+    int lanes_lo[8], lanes_hi[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes_lo), lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes_hi), hi);
+    int unused;
+    minMaxScalar(lanes_lo, 8, low, unused);
+    minMaxScalar(lanes_hi, 8, unused, high);
+    for (; i < n; i++)
+    {
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+    }
+}
+
+__attribute__((target("avx2"))) void histogramAVX2(const int *values, size_t n, int base, uint32_t *counts, size_t buckets)
+{
+    if (n < HISTOGRAM_TABLES * buckets)
+    {
+        histogramScalar(values, n, base, counts, buckets);
+        return;
+    }
+    vector<uint32_t> tables(HISTOGRAM_TABLES * buckets);
+    uint32_t *table0 = tables.data(), *table1 = table0 + buckets, *table2 = table1 + buckets, *table3 = table2 + buckets;
+    __m256i offset = _mm256_set1_epi32(base);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i index = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i)), offset);
+        __m128i low = _mm256_castsi256_si128(index), high = _mm256_extracti128_si256(index, 1);
+        table0[_mm_cvtsi128_si32(low)]++;
+        table1[_mm_extract_epi32(low, 1)]++;
+        table2[_mm_extract_epi32(low, 2)]++;
+        table3[_mm_extract_epi32(low, 3)]++;
+        table0[_mm_cvtsi128_si32(high)]++;
+        table1[_mm_extract_epi32(high, 1)]++;
+        table2[_mm_extract_epi32(high, 2)]++;
+        table3[_mm_extract_epi32(high, 3)]++;
+    }
+    histogramScalar(values + i, n - i, base, counts, buckets);
+    size_t b = 0;
+    for (; b + 8 <= buckets; b += 8)
+    {
+        __m256i total = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(counts + b));
+        for (size_t table = 0; table < HISTOGRAM_TABLES; table++)
+        {
+            total = _mm256_add_epi32(total, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tables.data() + table * buckets + b)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(counts + b), total);
+    }
+    for (; b < buckets; b++)
+    {
+        for (size_t table = 0; table < HISTOGRAM_TABLES; table++)
+        {
+            counts[b] += tables[table * buckets + b];
+        }
+    }
+}
+
+// GCC 12's AVX-512 headers build the unmasked intrinsics on an undefined vector and then warn that it may be
+// used uninitialized; the warning is about the header, not these kernels
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f"))) double sumAVX512(const double *values, size_t n)
+{
+    __m512d a = _mm512_setzero_pd(), b = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        a = _mm512_add_pd(a, _mm512_loadu_pd(values + i));
+        b = _mm512_add_pd(b, _mm512_loadu_pd(values + i + 8));
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_add_pd(a, b));
+    return sumScalar(lanes, 8) + sumScalar(values + i, n - i);
+}
+
+__attribute__((target("avx512f"))) double dotAVX512(const double *x, const double *y, size_t n)
+{
+    __m512d a = _mm512_setzero_pd(), b = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        a = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), a);
+        b = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), b);
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_add_pd(a, b));
+    return sumScalar(lanes, 8) + dotScalar(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void minMaxAVX512(const int *values, size_t n, int &low, int &high)
+{
+    if (n < 16)
+    {
+        minMaxScalar(values, n, low, high);
+        return;
+    }
+    __m512i lo = _mm512_loadu_si512(values);
+    __m512i hi = lo;
+    size_t i = 16;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        lo = _mm512_min_epi32(lo, v);
+        hi = _mm512_max_epi32(hi, v);
+    }
+    int lanes_lo[16], lanes_hi[16];
+    _mm512_storeu_si512(lanes_lo, lo);
+    _mm512_storeu_si512(lanes_hi, hi);
+    int unused;
+    minMaxScalar(lanes_lo, 16, low, unused);
+    minMaxScalar(lanes_hi, 16, unused, high);
+    for (; i < n; i++)
+    {
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+    }
+}
+
+// AVX-512 gathers the counters of 16 values, adds to them and scatters them back. vpconflictd marks, for
+// every lane, the earlier lanes holding the same value; a lane adds one plus the number of them, and as the
+// scatter writes the lanes in order, the last lane of every value leaves the count of all of them
+__attribute__((target("avx512f,avx512cd"))) void histogramAVX512(const int *values, size_t n, int base, uint32_t *counts, size_t buckets)
+{
+    __m512i offset = _mm512_set1_epi32(base);
+    __m512i one = _mm512_set1_epi32(1);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i index = _mm512_sub_epi32(_mm512_loadu_si512(values + i), offset);
+        __m512i earlier = _mm512_conflict_epi32(index);
+        // Population count of the at most 15 conflict bits of every lane
+        earlier = _mm512_sub_epi32(earlier, _mm512_and_si512(_mm512_srli_epi32(earlier, 1), _mm512_set1_epi32(0x5555)));
+        earlier = _mm512_add_epi32(_mm512_and_si512(earlier, _mm512_set1_epi32(0x3333)), _mm512_and_si512(_mm512_srli_epi32(earlier, 2), _mm512_set1_epi32(0x3333)));
+        earlier = _mm512_and_si512(_mm512_add_epi32(earlier, _mm512_srli_epi32(earlier, 4)), _mm512_set1_epi32(0x0F0F));
+        earlier = _mm512_and_si512(_mm512_add_epi32(earlier, _mm512_srli_epi32(earlier, 8)), _mm512_set1_epi32(0x1F));
+        __m512i current = _mm512_i32gather_epi32(index, counts, 4);
+        _mm512_i32scatter_epi32(counts, index, _mm512_add_epi32(current, _mm512_add_epi32(earlier, one)), 4);
+    }
+    histogramScalar(values + i, n - i, base, counts, buckets);
+}
+#pragma GCC diagnostic pop
+#endif
+
+// Kernel sets from narrowest to widest
+const StatKernels STAT_KERNELS[] = {
+    {"scalar", sumScalar, dotScalar, minMaxScalar, histogramScalar},
+#ifdef HAVE_X86_KERNELS
+    {"sse2", sumSSE2, dotSSE2, minMaxSSE2, histogramSSE2},
+    {"avx2", sumAVX2, dotAVX2, minMaxAVX2, histogramAVX2},
+    {"avx512", sumAVX512, dotAVX512, minMaxAVX512, histogramAVX512},
+#endif
+};
+
+// Widest kernel set allowed by --simd, empty means no limit
+string simd_limit;
+
+// Function to check whether the CPU can run a kernel set
+bool cpuSupports(const string &name)
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (name == "sse2")
+        return __builtin_cpu_supports("sse2");
+    if (name == "avx2")
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (name == "avx512")
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd");
+#endif
+    return name == "scalar";
+}
+
+// Function to choose the widest kernel set the CPU supports, stopping at simd_limit if it is set
+const StatKernels &selectStatKernels()
+{
+    const StatKernels *chosen = &STAT_KERNELS[0];
+    for (const StatKernels &kernels : STAT_KERNELS)
+    {
+        if (cpuSupports(kernels.name))
+        {
+            chosen = &kernels;
+        }
+        if (simd_limit == kernels.name)
+        {
+            break;
+        }
+    }
+    return *chosen;
+}
+
+// Function to get the kernel set, chosen on first use
+const StatKernels &statKernels()
+{
+    static const StatKernels &kernels = selectStatKernels();
+    return kernels;
+}
+
+// Numeric columns covered by the correlation matrix
+enum CorrelationColumn
+{
+    RUNTIME,
+    VOTE_AVERAGE,
+    POPULARITY,
+    REVENUE,
+    BUDGET,
+    CORRELATION_COLUMNS
+};
+
+const char *const CORRELATION_COLUMN_NAMES[CORRELATION_COLUMNS] = {"runtime", "vote_average", "popularity", "revenue", "budget"};
+
+// Means and co-moments of the correlation columns, where comoment[i][j] is the sum over the rows of
+// (x_i - mean_i) * (x_j - mean_j). Working with deviations from the mean avoids the cancellation in
+// n * sum_x2 - sum_x * sum_x, which loses most of its digits on revenue and budget
+struct CorrelationMatrix
+{
+    uint64_t count = 0;
+    double mean[CORRELATION_COLUMNS] = {};
+    double comoment[CORRELATION_COLUMNS][CORRELATION_COLUMNS] = {};
+
+    // Function to combine the statistics of another set of rows into these (Chan et al.)
+    void merge(const CorrelationMatrix &other)
+    {
+        if (other.count == 0)
+        {
+            return;
+        }
+        double total = static_cast<double>(count) + other.count;
+        double weight = static_cast<double>(count) * other.count / total;
+        double delta[CORRELATION_COLUMNS];
+        for (int i = 0; i < CORRELATION_COLUMNS; i++)
+        {
+            delta[i] = other.mean[i] - mean[i];
+        }
+        for (int i = 0; i < CORRELATION_COLUMNS; i++)
+        {
+            for (int j = 0; j < CORRELATION_COLUMNS; j++)
+            {
+                comoment[i][j] += other.comoment[i][j] + delta[i] * delta[j] * weight;
+            }
+            mean[i] += delta[i] * other.count / total;
+        }
+        count += other.count;
+    }
+};
+
+// Rows per block of the correlation pass. Every block is summarised on its own and the blocks are
+// merged in row order, so the result is the same whatever the number of threads
+const size_t CORRELATION_BLOCK_ROWS = 4096;
+
+// Function to summarise one block of rows given as one array per correlation column. The block's means
+// come from the sum kernel, then the columns are centred in place and the co-moments are dot products
+CorrelationMatrix summariseBlock(double *const *columns, size_t rows)
+{
+    const StatKernels &kernels = statKernels();
+    CorrelationMatrix block;
+    block.count = rows;
+    for (int i = 0; i < CORRELATION_COLUMNS; i++)
+    {
+        block.mean[i] = kernels.sum(columns[i], rows) / rows;
+        for (size_t r = 0; r < rows; r++)
+        {
+            columns[i][r] -= block.mean[i];
+        }
+    }
+    for (int i = 0; i < CORRELATION_COLUMNS; i++)
+    {
+        for (int j = i; j < CORRELATION_COLUMNS; j++)
+        {
+            block.comoment[i][j] = block.comoment[j][i] = kernels.dot(columns[i], columns[j], rows);
+        }
+    }
+    return block;
+}
+
+// Function to compute the correlation matrix of the table in one pass over the numeric columns
+CorrelationMatrix computeCorrelationMatrix(const MovieTable &table, WorkStealingPool &pool)
+{
+    size_t rows = table.size();
+    size_t blocks = (rows + CORRELATION_BLOCK_ROWS - 1) / CORRELATION_BLOCK_ROWS;
+    size_t workerCount = max<size_t>(1, min<size_t>(pool.size(), blocks));
+    vector<CorrelationMatrix> partial(blocks);
+    pool.run(workerCount, [&](size_t w)
+    {
+        vector<double> buffer(CORRELATION_COLUMNS * CORRELATION_BLOCK_ROWS);
+        double *columns[CORRELATION_COLUMNS];
+        for (int i = 0; i < CORRELATION_COLUMNS; i++)
+        {
+            columns[i] = buffer.data() + i * CORRELATION_BLOCK_ROWS;
+        }
+        for (size_t block = w; block < blocks; block += workerCount)
+        {
+            size_t begin = block * CORRELATION_BLOCK_ROWS;
+            size_t count = min(rows, begin + CORRELATION_BLOCK_ROWS) - begin;
+            for (size_t r = 0; r < count; r++)
+            {
+                columns[RUNTIME][r] = table.runtime[begin + r];
+                columns[VOTE_AVERAGE][r] = table.vote_average[begin + r];
+                columns[POPULARITY][r] = table.popularity[begin + r];
+                columns[REVENUE][r] = static_cast<double>(table.revenue[begin + r]);
+                columns[BUDGET][r] = static_cast<double>(table.budget[begin + r]);
+            }
+            partial[block] = summariseBlock(columns, count);
+        }
+    });
+
+    CorrelationMatrix matrix;
+    for (const CorrelationMatrix &block : partial)
+    {
+        matrix.merge(block);
+    }
+    return matrix;
+}
+
+// Widest runtime range counted with a histogram, wider ranges are sorted instead
+const int64_t RUNTIME_HISTOGRAM_LIMIT = 1 << 20;
+
+// Function to count how many movies have each runtime, in ascending order of runtime
+vector<pair<int, long long>> runtimeHistogram(const MovieTable &table)
+{
+    const StatKernels &kernels = statKernels();
+    const Column<int> &runtimes = table.runtime;
+    size_t n = runtimes.size();
+    vector<pair<int, long long>> histogram;
+    if (n == 0)
+    {
+        return histogram;
+    }
+
+    int low, high;
+    kernels.minMax(runtimes.data(), n, low, high);
+    if (static_cast<int64_t>(high) - low < RUNTIME_HISTOGRAM_LIMIT)
+    {
+        vector<uint32_t> counts(static_cast<size_t>(static_cast<int64_t>(high) - low + 1));
+        kernels.histogram(runtimes.data(), n, low, counts.data(), counts.size());
+        for (size_t v = 0; v < counts.size(); v++)
+        {
+            if (counts[v] > 0)
+            {
+                histogram.emplace_back(static_cast<int>(low + static_cast<int64_t>(v)), counts[v]);
+            }
+        }
+    }
+    else
+    {
+        vector<int> sortedRuntimes(runtimes.begin(), runtimes.end());
+        sort(sortedRuntimes.begin(), sortedRuntimes.end());
+        for (int runtime : sortedRuntimes)
+        {
+            if (histogram.empty() || histogram.back().first != runtime)
+            {
+                histogram.emplace_back(runtime, 0);
+            }
+            histogram.back().second++;
+        }
+    }
+    return histogram;
+}
+
+// Function to print the mean, median, mode and standard deviation of the runtimes, all read from the
+// runtime histogram so the report needs no other column. The mean and the standard deviation are weighted
+// sums over the histogram, taken with the sum and dot kernels
+void analyzeRuntimeDistribution(const vector<pair<int, long long>> &histogram)
+{
+    const StatKernels &kernels = statKernels();
+    vector<double> runtimes(histogram.size()), counts(histogram.size());
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        runtimes[i] = histogram[i].first;
+        counts[i] = static_cast<double>(histogram[i].second);
+    }
+    uint64_t n = static_cast<uint64_t>(kernels.sum(counts.data(), counts.size()));
+    if (n == 0)
+    {
+        cout << "No runtimes to analyze" << endl;
+        return;
+    }
+    double mean = kernels.dot(runtimes.data(), counts.data(), runtimes.size()) / n;
+    // runtimes becomes the deviations from the mean and counts the deviations weighted by their counts
+    for (size_t i = 0; i < runtimes.size(); i++)
+    {
+        runtimes[i] -= mean;
+        counts[i] *= runtimes[i];
+    }
+    double stdDeviation = sqrt(kernels.dot(runtimes.data(), counts.data(), runtimes.size()) / n);
+
+    // The median is the middle of the sorted runtimes and the mode the smallest of the most frequent runtimes
+    int median = 0, mode = 0;
+    long long modeCount = 0;
+    uint64_t seen = 0;
+    bool medianFound = false;
+    for (const auto &entry : histogram)
+    {
+        seen += entry.second;
+        if (!medianFound && seen > n / 2)
+        {
+            median = entry.first;
+            medianFound = true;
+        }
+        if (entry.second > modeCount)
+        {
+            modeCount = entry.second;
+            mode = entry.first;
+        }
+    }
+
+    // Print the computed statistics
+    cout << "Runtime Distribution:" << endl;
+    cout << "Mean Runtime: " << mean << endl;
+    cout << "Median Runtime: " << median << endl;
+    cout << "Mode Runtime: " << mode << " (appeared " << modeCount << " times)" << endl;
+    cout << "Standard Deviation of Runtimes: " << stdDeviation << endl;
+}
+
+// Function to read the correlation and regression line of y on x out of the matrix
+CorrelationResult correlationOf(const CorrelationMatrix &matrix, CorrelationColumn x, CorrelationColumn y)
+{
+    double n = static_cast<double>(matrix.count);
+    double cxx = matrix.comoment[x][x];
+    double cyy = matrix.comoment[y][y];
+    double cxy = matrix.comoment[x][y];
+
+    // The raw sums are reported as before, rebuilt from the means and co-moments
+    CorrelationResult result;
+    result.sum_x = n * matrix.mean[x];
+    result.sum_y = n * matrix.mean[y];
+    result.sum_xy = cxy + n * matrix.mean[x] * matrix.mean[y];
+    result.sum_x2 = cxx + n * matrix.mean[x] * matrix.mean[x];
+    result.sum_y2 = cyy + n * matrix.mean[y] * matrix.mean[y];
+    result.denominator = n * sqrt(cxx * cyy);
+    result.correlation_coefficient = 0.0;
+    result.slope = 0;
+    result.intercept = 0;
+    if (result.denominator != 0)
+    {
+        result.correlation_coefficient = cxy / sqrt(cxx * cyy);
+        result.slope = cxy / cxx;
+        result.intercept = matrix.mean[y] - result.slope * matrix.mean[x];
+    }
+    return result;
+}
+
+// Function to print the correlation between two columns with its details
+CorrelationResult correlation(const CorrelationMatrix &matrix, CorrelationColumn x, CorrelationColumn y)
+{
+    CorrelationResult result = correlationOf(matrix, x, y);
+    cout << "Correlation Coefficient: " << result.correlation_coefficient << endl;
+    cout << "Sum of x: " << result.sum_x << endl;
+    cout << "Sum of y: " << result.sum_y << endl;
+    cout << "Sum of xy: " << result.sum_xy << endl;
+    cout << "Sum of x^2: " << result.sum_x2 << endl;
+    cout << "Sum of y^2: " << result.sum_y2 << endl;
+    cout << "Denominator: " << result.denominator << endl;
+    cout << "Linear Regression Equation: y = " << result.slope << "x + " << result.intercept << endl;
+    cout << endl;
+
+    return result;
+}
+
+// Function to print every pairwise correlation coefficient and regression line of the matrix
+void printCorrelationMatrix(const CorrelationMatrix &matrix)
+{
+    cout << "Correlation matrix over " << matrix.count << " movies:" << endl;
+    cout << setw(14) << "";
+    for (int j = 0; j < CORRELATION_COLUMNS; j++)
+    {
+        cout << setw(14) << CORRELATION_COLUMN_NAMES[j];
+    }
+    cout << endl;
+    for (int i = 0; i < CORRELATION_COLUMNS; i++)
+    {
+        cout << setw(14) << CORRELATION_COLUMN_NAMES[i];
+        for (int j = 0; j < CORRELATION_COLUMNS; j++)
+        {
+            cout << setw(14) << correlationOf(matrix, CorrelationColumn(i), CorrelationColumn(j)).correlation_coefficient;
+        }
+        cout << endl;
+    }
+    cout << endl;
+
+    cout << "Regression lines:" << endl;
+    for (int i = 0; i < CORRELATION_COLUMNS; i++)
+    {
+        for (int j = 0; j < CORRELATION_COLUMNS; j++)
+        {
+            if (i != j)
+            {
+                CorrelationResult result = correlationOf(matrix, CorrelationColumn(i), CorrelationColumn(j));
+                cout << CORRELATION_COLUMN_NAMES[j] << " = " << result.slope << " * " << CORRELATION_COLUMN_NAMES[i] << " + " << result.intercept << endl;
+            }
+        }
+    }
+    cout << endl;
+}
+
+// Function to count the frequencies of each genre
+void countAllGenresFrequency(QueryResult genres)
+{
+    genres.sortByGroup();
+
+    // Print each genre and its count
+    for (size_t g = 0; g < genres.size(); g++)
+    {
+        cout << genres.groups[g] << ": " << genres.integerValue(g) << endl;
+    }
+}
+
+// Function to count the frequency of release years
+void countReleaseYearFrequency(QueryResult years)
+{
+    years.sortBy(0);
+
+    // Print the year frequencies in descending order
+    for (size_t g = 0; g < years.size(); g++)
+    {
+        cout << years.groups[g] << ": " << years.integerValue(g) << endl;
+    }
+}
+
+// One entry of a posting list: a row whose title contains the term, how often, and the token
+// position of its first occurrence in the title
+struct Posting
+{
+    uint64_t row;
+    uint32_t count;
+    uint32_t position;
+};
+
+// Inverted index over the whitespace-separated tokens of a range of titles. Every distinct token is a term
+// of the dictionary, and its posting list holds the rows containing it in row order, varint encoded as
+// (row delta, count, position); the first delta counts from row 0. Reports normalise each distinct term
+// once instead of every occurrence
+class TitleSegment
+{
+public:
+    Dictionary terms;
+    Column<uint8_t> postings;
+    Column<uint64_t> posting_offsets = {0}; // Postings of term t are the bytes [posting_offsets[t], posting_offsets[t + 1])
+    uint64_t first_row = 0;                 // Rows [first_row, end_row) are indexed
+    uint64_t end_row = 0;
+
+    TitleSegment() = default;
+
+    // Function to tokenize the titles of rows [begin, end) and build their index
+    TitleSegment(const StringColumn &titles, size_t begin, size_t end) : first_row(begin), end_row(end)
+    {
+        vector<vector<uint8_t>> lists;
+        vector<uint64_t> lastRow;
+        vector<Posting> rowTerms; // Terms of the current title, row holds the term id
+        for (size_t row = begin; row < end; row++)
+        {
+            string_view title = titles[row];
+            rowTerms.clear();
+            uint32_t position = 0;
+            size_t i = 0;
+            while (i < title.size())
+            {
+                while (i < title.size() && isspace(static_cast<unsigned char>(title[i])))
+                {
+                    i++;
+                }
+                size_t start = i;
+                while (i < title.size() && !isspace(static_cast<unsigned char>(title[i])))
+                {
+                    i++;
+                }
+                if (i == start)
+                {
+                    break;
+                }
+                uint32_t term = terms.intern(title.substr(start, i - start));
+                bool found = false;
+                for (Posting &entry : rowTerms)
+                {
+                    if (entry.row == term)
+                    {
+                        entry.count++;
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found)
+                {
+                    rowTerms.push_back({term, 1, position});
+                }
+                position++;
+            }
+
+            for (const Posting &entry : rowTerms)
+            {
+                if (entry.row == lists.size())
+                {
+                    lists.emplace_back();
+                    lastRow.push_back(0);
+                }
+                vector<uint8_t> &list = lists[entry.row];
+                putVarint(list, row - lastRow[entry.row]);
+                putVarint(list, entry.count);
+                putVarint(list, entry.position);
+                lastRow[entry.row] = row;
+            }
+        }
+
+        for (const vector<uint8_t> &list : lists)
+        {
+            postings.append(list.data(), list.data() + list.size());
+            posting_offsets.push_back(postings.size());
+        }
+    }
+
+    size_t size() const { return terms.size(); }
+
+    // Function to call visit with every posting of a term, in row order
+    template <typename Visitor>
+    void forEachPosting(uint32_t term, Visitor &&visit) const
+    {
+        const uint8_t *pos = postings.data() + posting_offsets[term];
+        const uint8_t *end = postings.data() + posting_offsets[term + 1];
+        Posting posting = {0, 0, 0};
+        while (pos < end)
+        {
+            posting.row += getVarint(pos);
+            posting.count = static_cast<uint32_t>(getVarint(pos));
+            posting.position = static_cast<uint32_t>(getVarint(pos));
+            visit(posting);
+        }
+    }
+
+private:
+    static void putVarint(vector<uint8_t> &out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint64_t getVarint(const uint8_t *&pos)
+    {
+        uint64_t value = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            uint8_t byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80)
+            {
+                return value;
+            }
+        }
+    }
+};
+
+// Title index made of one segment per contiguous slice of rows. The segments are built as tasks of the
+// pool and word counts are taken per segment, so both scale with the number of threads
+class TitleIndex
+{
+public:
+    vector<TitleSegment> segments;
+    uint64_t rows = 0; // Number of titles indexed
+
+    TitleIndex() = default;
+
+    // Function to tokenize every title once and build the index, with one segment per thread of the pool
+    TitleIndex(const StringColumn &titles, WorkStealingPool &pool)
+    {
+        rows = titles.size();
+        size_t count = max<size_t>(1, min<size_t>(pool.size(), rows));
+        segments.resize(count);
+        pool.run(count, [&](size_t w)
+        {
+            segments[w] = TitleSegment(titles, rows * w / count, rows * (w + 1) / count);
+        });
+    }
+};
+
+// Function to lowercase a title word, the normalisation of the overall word count
+string lowercaseWord(string_view word)
+{
+    string lowercase;
+    for (char c : word)
+    {
+        lowercase += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    return lowercase;
+}
+
+// Function to reduce a title word to its first run of letters and digits, lowercased. This drops
+// leading and trailing punctuation for the per-language and per-year counts
+string alphanumericWord(string_view word)
+{
+    string lowercase;
+    for (char c : word)
+    {
+        if (isalnum(c)) // Check if the character is alphanumeric
+        {
+            lowercase += tolower(c); // Convert to lowercase
+        }
+        else if (!lowercase.empty()) // Only append non-leading/trailing punctuation
+        {
+            break;
+        }
+    }
+    return lowercase;
+}
+
+// Function to give every term of every segment a word id under a normalisation, or -1 when the
+// term normalises to an empty or ignored word. The words themselves are collected in words
+template <typename Normalise>
+vector<vector<int32_t>> mapTerms(const TitleIndex &index, Normalise normalise, const vector<string> &ignoredWords, Dictionary &words)
+{
+    vector<vector<int32_t>> termWord;
+    for (const TitleSegment &segment : index.segments)
+    {
+        termWord.emplace_back(segment.size(), -1);
+        for (uint32_t term = 0; term < segment.size(); term++)
+        {
+            string word = normalise(segment.terms[term]);
+            if (!word.empty() && !binarySearch(ignoredWords, word))
+            {
+                termWord.back()[term] = static_cast<int32_t>(words.intern(word));
+            }
+        }
+    }
+    return termWord;
+}
+
+// Aggregate for indexed word counts: adds up a word's occurrences and remembers where it first appeared
+struct OccurrenceAggregate
+{
+    struct State
+    {
+        long long count;
+        uint64_t first_row;
+        uint32_t first_position;
+    };
+    static State initial() { return {0, numeric_limits<uint64_t>::max(), 0}; }
+    static void add(State &state, const Posting &posting)
+    {
+        state.count += posting.count;
+        if (posting.row < state.first_row || (posting.row == state.first_row && posting.position < state.first_position))
+        {
+            state.first_row = posting.row;
+            state.first_position = posting.position;
+        }
+    }
+    static void merge(State &state, const State &other)
+    {
+        state.count += other.count;
+        if (other.first_row < state.first_row || (other.first_row == state.first_row && other.first_position < state.first_position))
+        {
+            state.first_row = other.first_row;
+            state.first_position = other.first_position;
+        }
+    }
+    static const State &result(const State &state) { return state; }
+};
+
+// Word counted for one group of rows
+struct GroupWord
+{
+    uint32_t word;
+    OccurrenceAggregate::State occurrences;
+};
+
+// Function to count the words of every group of rows by walking the posting lists. rowGroup gives the
+// group of every row or -1 to leave the row out, termWord comes from mapTerms. Every segment is counted
+// into its own table as a task of the pool, and the tables are merged pairwise in a reduction tree.
+// Every group's words come back in order of first appearance in its titles, which is the order a scan
+// over the rows would find them, so the result does not depend on the number of segments
+vector<vector<GroupWord>> countGroupWords(const TitleIndex &index, const vector<int32_t> &rowGroup, size_t groups, const vector<vector<int32_t>> &termWord, WorkStealingPool &pool)
+{
+    using WordCounts = HashAggregator<uint64_t, OccurrenceAggregate>;
+    vector<WordCounts> partial(max<size_t>(1, index.segments.size()));
+    pool.run(index.segments.size(), [&](size_t s)
+    {
+        const TitleSegment &segment = index.segments[s];
+        for (uint32_t term = 0; term < segment.size(); term++)
+        {
+            int32_t word = termWord[s][term];
+            if (word < 0)
+            {
+                continue;
+            }
+            segment.forEachPosting(term, [&](const Posting &posting)
+            {
+                int32_t group = rowGroup[posting.row];
+                if (group >= 0)
+                {
+                    partial[s].add(static_cast<uint64_t>(group) << 32 | static_cast<uint32_t>(word), posting);
+                }
+            });
+        }
+    });
+    for (size_t step = 1; step < partial.size(); step *= 2)
+    {
+        // Table s takes in table s + step for every s that is a multiple of 2 * step
+        size_t pairs = (partial.size() - step + 2 * step - 1) / (2 * step);
+        pool.run(pairs, [&](size_t p)
+        {
+            partial[p * 2 * step].merge(partial[p * 2 * step + step]);
+        });
+    }
+    const WordCounts &counts = partial[0];
+
+    vector<vector<GroupWord>> result(groups);
+    for (size_t g = 0; g < counts.size(); g++)
+    {
+        result[counts.key(g) >> 32].push_back({static_cast<uint32_t>(counts.key(g)), counts.result(g)});
+    }
+    for (vector<GroupWord> &groupWords : result)
+    {
+        sort(groupWords.begin(), groupWords.end(), [](const GroupWord &a, const GroupWord &b)
+        {
+            if (a.occurrences.first_row != b.occurrences.first_row)
+                return a.occurrences.first_row < b.occurrences.first_row;
+            return a.occurrences.first_position < b.occurrences.first_position;
+        });
+    }
+    return result;
+}
+
+// Function to turn counted words into WordFrequency entries
+void appendWordFrequencies(vector<WordFrequency> &wordFreq, const vector<GroupWord> &groupWords, const Dictionary &words)
+{
+    for (const GroupWord &groupWord : groupWords)
+    {
+        wordFreq.push_back({string(words[groupWord.word]), static_cast<int>(groupWord.occurrences.count)});
+    }
+}
+
+// Function to count word frequencies in movie titles, ignoring certain words
+vector<WordFrequency> countWords(const TitleIndex &index, vector<string> &ignoredWords, WorkStealingPool &pool)
+{
+    Dictionary words;
+    vector<vector<int32_t>> termWord = mapTerms(index, lowercaseWord, ignoredWords, words);
+
+    // Every row belongs to the same single group
+    vector<int32_t> rowGroup(index.rows, 0);
+
+    vector<WordFrequency> wordFreq;
+    appendWordFrequencies(wordFreq, countGroupWords(index, rowGroup, 1, termWord, pool)[0], words);
+    return wordFreq;
+}
+
+// Function to count the freqencies of words in titles according to each original language
+vector<vector<WordFrequency>> countTitleWordsByOriginalLanguage(const MovieTable &table, const TitleIndex &index, vector<string> &ignoredLanguages, vector<string> &ignoredWords, WorkStealingPool &pool)
+{
+    bucketSort(ignoredLanguages);
+
+    // Look every language up in the ignored list once, rows of ignored languages are left out
+    const CategoryColumn &languages = table.original_language;
+    vector<char> ignoredLanguage(languages.dictionary.size());
+    for (uint32_t id = 0; id < languages.dictionary.size(); id++)
+    {
+        ignoredLanguage[id] = binarySearch(ignoredLanguages, string(languages.dictionary[id]));
+    }
+    vector<int32_t> rowGroup(table.size());
+    for (size_t row = 0; row < table.size(); row++)
+    {
+        uint32_t language = languages.id(row);
+        rowGroup[row] = ignoredLanguage[language] ? -1 : static_cast<int32_t>(language);
+    }
+
+    Dictionary words;
+    vector<vector<int32_t>> termWord = mapTerms(index, alphanumericWord, ignoredWords, words);
+    vector<vector<GroupWord>> languageWords = countGroupWords(index, rowGroup, languages.dictionary.size(), termWord, pool);
+
+    // A language gets an entry once one of its titles has a counted word, entries are in order of that first word
+    vector<uint32_t> order;
+    for (uint32_t language = 0; language < languageWords.size(); language++)
+    {
+        if (!languageWords[language].empty())
+        {
+            order.push_back(language);
+        }
+    }
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+    {
+        const OccurrenceAggregate::State &first_a = languageWords[a][0].occurrences;
+        const OccurrenceAggregate::State &first_b = languageWords[b][0].occurrences;
+        if (first_a.first_row != first_b.first_row)
+            return first_a.first_row < first_b.first_row;
+        return first_a.first_position < first_b.first_position;
+    });
+
+    // The first element of every entry names the language, its words follow
+    vector<vector<WordFrequency>> languageTitleWordFreq;
+    for (uint32_t language : order)
+    {
+        vector<WordFrequency> languageEntry;
+        languageEntry.push_back({string(languages.dictionary[language]), 1});
+        appendWordFrequencies(languageEntry, languageWords[language], words);
+        languageTitleWordFreq.push_back(move(languageEntry));
+    }
+    return languageTitleWordFreq;
+}
+
+// Function to count word frequencies in movie titles segregated by year
+vector<pair<int, vector<WordFrequency>>> countTitleWordsByYear(const MovieTable &table, const TitleIndex &index, vector<string> &ignoredWords, WorkStealingPool &pool)
 {
-
     vector<pair<int, vector<WordFrequency>>> yearTitleWordFreq;
     vector<int> excludedYears = {
         1911,
@@ -1075,438 +4464,2115 @@ vector<pair<int, vector<WordFrequency>>> countTitleWordsByYear(const vector<Movi
         2025,
         2026};
 
-    for (const Movie &movie : movies)
+    // Give every release year an entry in order of its first movie, and every row the entry of its year
+    HashAggregator<int, CountAggregate> years;
+    vector<int32_t> rowGroup(table.size(), -1);
+    for (size_t row = 0; row < table.size(); row++)
+    {
+        if (table.released[row] == 0)
+        {
+            continue;
+        }
+        int year = releaseYear(table.released[row]);
+        if (find(excludedYears.begin(), excludedYears.end(), year) != excludedYears.end())
+        {
+            continue;
+        }
+        rowGroup[row] = static_cast<int32_t>(years.add(year, 1));
+    }
+
+    Dictionary words;
+    vector<vector<int32_t>> termWord = mapTerms(index, alphanumericWord, ignoredWords, words);
+    vector<vector<GroupWord>> yearWords = countGroupWords(index, rowGroup, years.size(), termWord, pool);
+    for (size_t g = 0; g < years.size(); g++)
+    {
+        vector<WordFrequency> wordFreq;
+        appendWordFrequencies(wordFreq, yearWords[g], words);
+        yearTitleWordFreq.push_back({years.key(g), move(wordFreq)});
+    }
+    return yearTitleWordFreq;
+}
+
+void displayTopWordsByYear(const vector<pair<int, vector<WordFrequency>>> &yearTitleWordFreq, int numYears)
+{
+    // Pick the latest years
+    vector<uint64_t> years = topK(yearTitleWordFreq.size(), numYears, [&](uint64_t a, uint64_t b)
+                                  { return yearTitleWordFreq[a].first > yearTitleWordFreq[b].first; });
+
+    cout << "Top 10 words in movie titles segregated by year:" << endl;
+    for (uint64_t year : years)
+    {
+        const auto &yearEntry = yearTitleWordFreq[year];
+        cout << "Year: " << yearEntry.first << endl;
+        for (uint64_t word : topWords(yearEntry.second, 10))
+        {
+            const WordFrequency &wf = yearEntry.second[word];
+            cout << wf.word << ": " << wf.frequency << " occurrences" << endl;
+        }
+        cout << "--------------------------" << endl;
+    }
+}
+
+void displayTopWords(const vector<WordFrequency> &wordFreq, int limit)
+{
+    cout << "Top " << limit << " most common words in movie titles:" << endl;
+    for (uint64_t word : topWords(wordFreq, limit))
+    {
+        const WordFrequency &wf = wordFreq[word];
+        cout << wf.word << ": " << wf.frequency << " occurrences" << endl;
+    }
+}
+
+void displayWordFreqByLanguage(const vector<vector<WordFrequency>> &titleWordFreqByLanguage, int limit)
+{
+    cout << "Word frequencies in movie taglines according to original language (excluding ignored languages):" << endl;
+    for (const auto &languageEntry : titleWordFreqByLanguage)
+    {
+        cout << "Original Language: " << languageEntry[0].word << endl;
+        for (size_t i = 1; i < min(languageEntry.size(), static_cast<size_t>(limit + 1)); i++) // Display top 'limit' words
+        {
+            cout << languageEntry[i].word << ": " << languageEntry[i].frequency << endl;
+        }
+        cout << "--------------------------" << endl;
+    }
+}
+
+void displayTopProductionCompanies(const vector<CompanyInfo> &companies, const vector<uint64_t> &order)
+{
+    cout << "Top 10 Production Companies by Total Revenue:\n";
+    int count = 0;
+    for (uint64_t index : order)
+    {
+        if (count >= 10)
+            break;
+        const CompanyInfo &company = companies[index];
+        cout << company.name << " - Total Revenue: $" << company.totalRevenue << ", Produced Countries: ";
+        for (size_t i = 0; i < company.producedCountries.size(); ++i)
+        {
+            cout << company.producedCountries[i];
+            if (i != company.producedCountries.size() - 1)
+            {
+                cout << ", ";
+            }
+        }
+        cout << endl;
+        count++;
+    }
+}
+
+// A movie of a top-N list with what the listing prints
+struct TopMovie
+{
+    uint64_t row; // Row counted over every movie loaded so far, equal keys rank the earlier row first
+    string title;
+    long long revenue;
+    float popularity;
+    vector<string> companies;
+};
+
+// Function to copy the movies of a view out of the table, with rows numbered from firstRow
+vector<TopMovie> topMovieRecords(const TableView &view, uint64_t firstRow)
+{
+    const MovieTable &table = view.table();
+    vector<TopMovie> movies;
+    for (uint64_t row : view.rows())
+    {
+        TopMovie movie = {firstRow + row, string(table.title[row]), table.revenue[row], table.popularity[row], {}};
+        for (size_t j = table.production_companies.first(row); j < table.production_companies.last(row); j++)
+        {
+            movie.companies.emplace_back(table.production_companies.value(j));
+        }
+        movies.push_back(move(movie));
+    }
+    return movies;
+}
+
+// Function to keep the k best of two top-N lists, ranked as topMoviesByRevenue or topMoviesByPopularity rank them
+vector<TopMovie> mergeTopMovies(const vector<TopMovie> &left, const vector<TopMovie> &right, size_t k, bool byPopularity)
+{
+    vector<TopMovie> candidates = left;
+    candidates.insert(candidates.end(), right.begin(), right.end());
+    vector<uint64_t> best = topK(candidates.size(), k, [&](uint64_t a, uint64_t b)
+                                 {
+                                     const TopMovie &x = candidates[a];
+                                     const TopMovie &y = candidates[b];
+                                     if (byPopularity && x.popularity != y.popularity)
+                                         return x.popularity > y.popularity;
+                                     if (x.revenue != y.revenue)
+                                         return x.revenue > y.revenue;
+                                     return x.row < y.row; });
+    vector<TopMovie> merged;
+    for (uint64_t i : best)
+    {
+        merged.push_back(candidates[i]);
+    }
+    return merged;
+}
+
+void printTopMoviesByRevenue(const vector<TopMovie> &movies, int limit)
+{
+    cout << "Top " << limit << " Movie Titles with Highest Revenue and Their Production Companies:\n";
+    int count = 0;
+    for (const TopMovie &movie : movies)
+    {
+        if (count >= limit)
+            break;
+        cout << "Title: " << movie.title << " - Revenue: $" << movie.revenue << endl;
+        cout << "Production Company: ";
+        for (const string &company : movie.companies)
+        {
+            cout << company << ", ";
+        }
+        cout << endl
+             << endl;
+        count++;
+    }
+}
+
+void printTopMoviesByPopularity(const vector<TopMovie> &movies, int limit)
+{
+    cout << "Top " << limit << " Movie Titles with Highest Popularity and Their Production Companies:\n";
+    int count = 0;
+    for (const TopMovie &movie : movies)
+    {
+        if (count >= limit)
+            break;
+        cout << "Title: " << movie.title << " - Popularity: $" << movie.popularity << endl;
+        cout << "Production Company: ";
+        for (const string &company : movie.companies)
+        {
+            cout << company << ", ";
+        }
+        cout << endl
+             << endl;
+        count++;
+    }
+}
+
+void languageDistribution(const QueryResult &languages)
+{
+    // Display language distribution
+    cout << "Language Distribution:" << endl;
+    for (size_t g = 0; g < languages.size(); ++g)
+    {
+        cout << languages.groups[g] << ": " << languages.integerValue(g) << " movies \n";
+    }
+}
+
+// Reports that can be selected on the command line
+enum Report
+{
+    REPORT_COMPANIES = 1 << 0,
+    REPORT_COUNTRIES = 1 << 1,
+    REPORT_GENRES = 1 << 2,
+    REPORT_YEARS = 1 << 3,
+    REPORT_CORRELATIONS = 1 << 4,
+    REPORT_LANGUAGES = 1 << 5,
+    REPORT_RUNTIME = 1 << 6,
+    REPORT_WORDS = 1 << 7,
+    REPORT_TOP_MOVIES = 1 << 8
+};
+
+// Set of reports, one bit per report
+using ReportSet = uint32_t;
+const ReportSet ALL_REPORTS = (1u << 9) - 1;
+
+// Name of a report and the CSV columns it reads
+struct ReportColumns
+{
+    const char *name;
+    Report report;
+    ColumnSet columns;
+};
+
+const ReportColumns REPORTS[] = {
+    {"companies", REPORT_COMPANIES, columnBit(CSV_PRODUCTION_COMPANIES) | columnBit(CSV_PRODUCTION_COUNTRIES) | columnBit(CSV_REVENUE)},
+    {"countries", REPORT_COUNTRIES, columnBit(CSV_PRODUCTION_COUNTRIES) | columnBit(CSV_REVENUE) | columnBit(CSV_VOTE_AVERAGE) | columnBit(CSV_POPULARITY)},
+    {"genres", REPORT_GENRES, columnBit(CSV_GENRES)},
+    {"years", REPORT_YEARS, columnBit(CSV_RELEASE_DATE)},
+    {"correlations", REPORT_CORRELATIONS, columnBit(CSV_RUNTIME) | columnBit(CSV_VOTE_AVERAGE) | columnBit(CSV_POPULARITY) | columnBit(CSV_REVENUE) | columnBit(CSV_BUDGET)},
+    {"languages", REPORT_LANGUAGES, columnBit(CSV_ORIGINAL_LANGUAGE)},
+    {"runtime", REPORT_RUNTIME, columnBit(CSV_RUNTIME)},
+    {"words", REPORT_WORDS, columnBit(CSV_TITLE) | columnBit(CSV_ORIGINAL_LANGUAGE) | columnBit(CSV_RELEASE_DATE)},
+    {"top", REPORT_TOP_MOVIES, columnBit(CSV_TITLE) | columnBit(CSV_REVENUE) | columnBit(CSV_POPULARITY) | columnBit(CSV_PRODUCTION_COMPANIES)}};
+
+// Function to find the columns the selected reports read between them
+ColumnSet reportColumns(ReportSet reports)
+{
+    ColumnSet columns = 0;
+    for (const ReportColumns &entry : REPORTS)
+    {
+        if (reports & entry.report)
+        {
+            columns |= entry.columns;
+        }
+    }
+    return columns;
+}
+
+// Function to read a comma-separated list of report names, returns false on an unknown name
+bool parseReports(const string &list, ReportSet &reports)
+{
+    reports = 0;
+    for (const string &name : split(list, ','))
+    {
+        auto entry = find_if(begin(REPORTS), end(REPORTS), [&](const ReportColumns &report)
+        {
+            return name == report.name;
+        });
+        if (entry == end(REPORTS))
+        {
+            cerr << "Unknown report: " << name << endl;
+            return false;
+        }
+        reports |= entry->report;
+    }
+    if (reports == 0)
+    {
+        cerr << "No reports selected" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Command-line options of the report
+struct Options
+{
+    string filename = "animated_movies.csv";
+    unsigned threads = 1;   // Threads used to parse the CSV and scan the columns, 0 picks one per core
+    string snapshot;        // Snapshot file, defaults to the CSV name with ".snapshot" appended
+    bool use_snapshot = true;
+    bool correlation_matrix = false; // Also print the full correlation matrix and regression lines
+    string state;           // Report state file, defaults to the CSV name with ".state" appended
+    string append;          // CSV of movies added since the report state was saved, empty for a full run
+    bool stream = false;    // Count the CSV one batch at a time instead of loading it whole
+    size_t stream_batch = 64 << 20; // Bytes of CSV parsed per batch in streaming mode
+    string serve;           // Unix socket to answer requests on instead of printing the reports
+    unsigned workers = 4;   // Threads answering requests in server mode
+    uint64_t generate_rows = 0; // Rows of the synthetic CSV to write, 0 writes none
+    string generate_file;
+    uint64_t seed = 1;      // Seed of the synthetic CSV
+    bool bench = false;     // Run the benchmarks instead of printing the reports
+    unsigned bench_repeat = 5;
+    string bench_output;    // File for the benchmark results, standard output if empty
+    string profile;         // File for the per-stage profile as JSON, "-" for standard error, empty for none
+    ReportSet reports = ALL_REPORTS; // Reports to compute and print, only the columns they read are parsed
+};
+
+// Function to read the command-line options, returns false on an unknown or incomplete option
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threads = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (arg == "--csv" && i + 1 < argc)
+        {
+            options.filename = argv[++i];
+        }
+        else if (arg == "--snapshot" && i + 1 < argc)
+        {
+            options.snapshot = argv[++i];
+        }
+        else if (arg == "--no-snapshot")
+        {
+            options.use_snapshot = false;
+        }
+        else if (arg == "--correlation-matrix")
+        {
+            options.correlation_matrix = true;
+        }
+        else if (arg == "--simd" && i + 1 < argc)
+        {
+            simd_limit = argv[++i];
+        }
+        else if (arg == "--state" && i + 1 < argc)
+        {
+            options.state = argv[++i];
+        }
+        else if (arg == "--append" && i + 1 < argc)
+        {
+            options.append = argv[++i];
+        }
+        else if (arg == "--stream")
+        {
+            options.stream = true;
+        }
+        else if (arg == "--stream-batch" && i + 1 < argc)
+        {
+            options.stream_batch = max<size_t>(1, stoul(argv[++i])) << 20;
+        }
+        else if (arg == "--serve" && i + 1 < argc)
+        {
+            options.serve = argv[++i];
+        }
+        else if (arg == "--workers" && i + 1 < argc)
+        {
+            options.workers = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (arg == "--generate" && i + 2 < argc)
+        {
+            options.generate_rows = stoull(argv[++i]);
+            options.generate_file = argv[++i];
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.seed = stoull(argv[++i]);
+        }
+        else if (arg == "--bench")
+        {
+            options.bench = true;
+        }
+        else if (arg == "--bench-repeat" && i + 1 < argc)
+        {
+            options.bench_repeat = static_cast<unsigned>(stoul(argv[++i]));
+        }
+        else if (arg == "--bench-output" && i + 1 < argc)
+        {
+            options.bench_output = argv[++i];
+        }
+        else if (arg == "--profile" && i + 1 < argc)
+        {
+            options.profile = argv[++i];
+        }
+        else if (arg == "--reports" && i + 1 < argc)
+        {
+            if (!parseReports(argv[++i], options.reports))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--csv <file>] [--threads <count>] [--snapshot <file> | --no-snapshot] [--correlation-matrix] [--simd scalar|sse2|avx2|avx512] [--state <file>] [--append <file>] [--stream [--stream-batch <MB>]] [--serve <socket> [--workers <count>]] [--generate <rows> <file> [--seed <n>]] [--bench [--bench-repeat <n>] [--bench-output <file>]] [--profile <file>|-] [--reports <name>,...]" << endl;
+            return false;
+        }
+    }
+    if (options.snapshot.empty())
+    {
+        options.snapshot = options.filename + ".snapshot";
+    }
+    if (options.state.empty())
+    {
+        options.state = options.filename + ".state";
+    }
+    if (options.threads == 0)
+    {
+        options.threads = max(1u, thread::hardware_concurrency());
+    }
+    return true;
+}
+
+// Function to load the movies of the CSV file. The snapshot of an earlier run is reused if it was built
+// from the same CSV, otherwise the CSV is parsed and a snapshot written. A snapshot holds every column and
+// serves any later set of reports; without one only the columns in the set are parsed
+MovieTable loadMovies(const Options &options, WorkStealingPool &pool, const vector<bool> &remove_quotes, ColumnSet columns)
+{
+    ProfileScope stage(STAGE_PARSE);
+    MovieTable movies;
+    SourceIdentity source;
+    uint64_t config_hash = parserConfigHash(remove_quotes);
+    bool snapshot = options.use_snapshot && identifySource(options.filename, source);
+    if (!snapshot || !loadSnapshot(options.snapshot, source, config_hash, movies))
+    {
+        movies = loadMovieTable(options.filename, remove_quotes, pool, snapshot ? ALL_COLUMNS : columns);
+        if (snapshot && !saveSnapshot(options.snapshot, movies, source, config_hash))
+        {
+            cerr << "Warning: could not write snapshot " << options.snapshot << endl;
+        }
+    }
+    warnInvalidFields(movies, options.filename);
+    return movies;
+}
+
+// Everything the reports are printed from. Every part can be combined with the same part computed over
+// movies appended later, so an append only counts the new movies and merges them in
+struct ReportState
+{
+    SourceIdentity base;      // Size and modification time of the CSV the state was first built from
+    vector<uint64_t> applied; // Content hashes of the appended CSV files merged in so far
+    uint64_t rows = 0;
+    vector<CompanyInfo> companies;
+    QueryResult countries; // COUNTRY_TOTALS of every production country
+    QueryResult genres;
+    QueryResult years;
+    QueryResult languages;
+    CorrelationMatrix correlations;
+    vector<pair<int, long long>> runtimes; // Runtime histogram, ascending by runtime
+    vector<WordFrequency> words;
+    vector<vector<WordFrequency>> languageWords;
+    vector<pair<int, vector<WordFrequency>>> yearWords;
+    vector<TopMovie> topByRevenue;
+    vector<TopMovie> topByPopularity;
+};
+
+const vector<QueryAggregate> MOVIE_COUNT = {{AggregateOp::Count, Measure::None}};
+
+// Length of the top movie lists kept in the report state
+const size_t TOP_MOVIES = 10;
+
+// Function to compute the selected parts of the report state of a table whose first row is row firstRow of
+// all movies loaded. The table only has to hold the columns the selected reports read
+ReportState computeReportState(const MovieTable &table, vector<string> &ignoredLanguages, vector<string> &ignoredWords, WorkStealingPool &pool, uint64_t firstRow, ReportSet reports)
+{
+    ReportState state;
+    state.rows = table.size();
+    if (reports & REPORT_COMPANIES)
+    {
+        ProfileScope stage(STAGE_COMPANIES);
+        state.companies = processCompanyInfo(table);
+    }
+    if (reports & REPORT_COUNTRIES)
+    {
+        ProfileScope stage(STAGE_COUNTRY_QUERIES);
+        state.countries = groupBy(table, GroupKey::Country, COUNTRY_TOTALS);
+    }
+    if (reports & (REPORT_GENRES | REPORT_YEARS))
+    {
+        ProfileScope stage(STAGE_GENRE_YEAR_COUNTS);
+        if (reports & REPORT_GENRES)
+            state.genres = groupBy(table, GroupKey::Genre, MOVIE_COUNT);
+        if (reports & REPORT_YEARS)
+            state.years = groupBy(table, GroupKey::Year, MOVIE_COUNT);
+    }
+    if (reports & REPORT_LANGUAGES)
+    {
+        ProfileScope stage(STAGE_LANGUAGE_COUNTS);
+        state.languages = groupBy(table, GroupKey::Language, MOVIE_COUNT);
+    }
+    if (reports & REPORT_CORRELATIONS)
+    {
+        // All pairwise correlations come out of one pass over the numeric columns
+        ProfileScope stage(STAGE_CORRELATIONS);
+        state.correlations = computeCorrelationMatrix(table, pool);
+    }
+    if (reports & REPORT_RUNTIME)
+    {
+        ProfileScope stage(STAGE_RUNTIME_HISTOGRAM);
+        state.runtimes = runtimeHistogram(table);
+    }
+
+    if (reports & REPORT_WORDS)
+    {
+        // Tokenize every title once, the word counts are all read from this index
+        ProfileScope indexStage(STAGE_TITLE_INDEX);
+        TitleIndex titleIndex(table.title, pool);
+        indexStage.end();
+        ProfileScope stage(STAGE_WORD_COUNTS);
+        state.words = countWords(titleIndex, ignoredWords, pool);
+        state.languageWords = countTitleWordsByOriginalLanguage(table, titleIndex, ignoredLanguages, ignoredWords, pool);
+        state.yearWords = countTitleWordsByYear(table, titleIndex, ignoredWords, pool);
+    }
+    if (reports & REPORT_TOP_MOVIES)
+    {
+        ProfileScope stage(STAGE_SORTS);
+        state.topByRevenue = topMovieRecords(topMoviesByRevenue(table, TOP_MOVIES), firstRow);
+        state.topByPopularity = topMovieRecords(topMoviesByPopularity(table, TOP_MOVIES), firstRow);
+    }
+    return state;
+}
+
+// Function to add the word counts of other to wordFreq. Entries before first are not words and are left
+// alone, words new to wordFreq are appended in their order in other
+void mergeWordFrequencies(vector<WordFrequency> &wordFreq, const vector<WordFrequency> &other, size_t first)
+{
+    Dictionary words;
+    for (size_t i = first; i < wordFreq.size(); i++)
+    {
+        words.intern(wordFreq[i].word);
+    }
+    for (size_t i = first; i < other.size(); i++)
+    {
+        size_t index = first + words.intern(other[i].word);
+        if (index == wordFreq.size())
+        {
+            wordFreq.push_back(other[i]);
+        }
+        else
+        {
+            wordFreq[index].frequency += other[i].frequency;
+        }
+    }
+}
+
+// Function to add the revenue and countries of other's companies to companies, new companies go at the end
+void mergeCompanies(vector<CompanyInfo> &companies, const vector<CompanyInfo> &other)
+{
+    Dictionary names;
+    for (const CompanyInfo &company : companies)
+    {
+        names.intern(company.name);
+    }
+    for (const CompanyInfo &company : other)
+    {
+        uint32_t index = names.intern(company.name);
+        if (index == companies.size())
+        {
+            companies.push_back(company);
+            continue;
+        }
+        CompanyInfo &known = companies[index];
+        known.totalRevenue += company.totalRevenue;
+        for (const string &country : company.producedCountries)
+        {
+            if (find(known.producedCountries.begin(), known.producedCountries.end(), country) == known.producedCountries.end())
+            {
+                known.producedCountries.push_back(country);
+            }
+        }
+    }
+}
+
+// Function to add up two runtime histograms, both ascending by runtime
+vector<pair<int, long long>> mergeRuntimeHistograms(const vector<pair<int, long long>> &left, const vector<pair<int, long long>> &right)
+{
+    vector<pair<int, long long>> merged;
+    size_t i = 0, j = 0;
+    while (i < left.size() || j < right.size())
+    {
+        if (j == right.size() || (i < left.size() && left[i].first < right[j].first))
+        {
+            merged.push_back(left[i++]);
+        }
+        else if (i == left.size() || right[j].first < left[i].first)
+        {
+            merged.push_back(right[j++]);
+        }
+        else
+        {
+            merged.emplace_back(left[i].first, left[i].second + right[j].second);
+            i++;
+            j++;
+        }
+    }
+    return merged;
+}
+
+// Function to merge the state of appended movies into state. Groups, words and companies first seen in
+// the appended movies go after the ones already known, the order a full run over all movies gives them
+void mergeReportState(ReportState &state, const ReportState &delta)
+{
+    ProfileScope stage(STAGE_MERGE_STATE);
+    state.rows += delta.rows;
+    mergeCompanies(state.companies, delta.companies);
+    state.countries.merge(delta.countries);
+    state.genres.merge(delta.genres);
+    state.years.merge(delta.years);
+    state.languages.merge(delta.languages);
+    state.correlations.merge(delta.correlations);
+    state.runtimes = mergeRuntimeHistograms(state.runtimes, delta.runtimes);
+
+    mergeWordFrequencies(state.words, delta.words, 0);
+    // The first element of a language entry names the language
+    Dictionary languages;
+    for (const vector<WordFrequency> &languageEntry : state.languageWords)
+    {
+        languages.intern(languageEntry[0].word);
+    }
+    for (const vector<WordFrequency> &languageEntry : delta.languageWords)
+    {
+        uint32_t index = languages.intern(languageEntry[0].word);
+        if (index == state.languageWords.size())
+        {
+            state.languageWords.push_back(languageEntry);
+        }
+        else
+        {
+            mergeWordFrequencies(state.languageWords[index], languageEntry, 1);
+        }
+    }
+    HashAggregator<int, CountAggregate> years;
+    for (const auto &yearEntry : state.yearWords)
+    {
+        years.add(yearEntry.first, 1);
+    }
+    for (const auto &yearEntry : delta.yearWords)
+    {
+        bool inserted;
+        size_t index = years.group(yearEntry.first, inserted);
+        if (inserted)
+        {
+            state.yearWords.push_back(yearEntry);
+        }
+        else
+        {
+            mergeWordFrequencies(state.yearWords[index].second, yearEntry.second, 0);
+        }
+    }
+
+    state.topByRevenue = mergeTopMovies(state.topByRevenue, delta.topByRevenue, TOP_MOVIES, false);
+    state.topByPopularity = mergeTopMovies(state.topByPopularity, delta.topByPopularity, TOP_MOVIES, true);
+}
+
+// Function to compute the report state of the CSV one batch of records at a time, without a snapshot.
+// Only the batch being counted and the merged state are held, and the pages of the file already counted
+// are handed back to the kernel, so memory use follows the batch size and the number of distinct
+// companies, countries and words rather than the size of the file
+ReportState streamReportState(const Options &options, WorkStealingPool &pool, const vector<bool> &remove_quotes, vector<string> &ignoredLanguages, vector<string> &ignoredWords)
+{
+    ReportState state;
+    MappedFile file(options.filename);
+    if (!file.is_open())
+    {
+        cerr << "Error opening file: " << options.filename << endl;
+        return state;
+    }
+
+    string_view data = file.view();
+    string_view tokens[CSV_COLUMNS];
+    size_t pos = 0;
+    // Skip header line
+    splitRecord(data, pos, ',', tokens, CSV_COLUMNS, remove_quotes);
+    while (pos < data.size())
+    {
+        size_t start = pos;
+        MovieTable batch;
+        ProfileScope parseStage(STAGE_PARSE);
+        pos = parseRecords(data, pos, min(data.size(), pos + options.stream_batch), remove_quotes, batch, reportColumns(options.reports));
+        parseStage.end();
+        mergeReportState(state, computeReportState(batch, ignoredLanguages, ignoredWords, pool, state.rows, options.reports));
+        file.release(start, pos);
+    }
+    return state;
+}
+
+// Report state file layout: a magic string, the version and the setup hash, then every field of the state in
+// the order fields() visits them. Numbers are stored in native byte order, strings and lists after their length
+const char STATE_MAGIC[8] = {'M', 'O', 'V', 'S', 'T', 'A', 'T', '\0'};
+const uint32_t STATE_VERSION = 2;
+
+// Writes the fields of the report state to a stream
+class StateWriter
+{
+public:
+    explicit StateWriter(ostream &out) : out_(out) {}
+
+    template <typename T>
+    void value(const T &field)
+    {
+        if constexpr (is_arithmetic<T>::value || is_enum<T>::value)
+        {
+            out_.write(reinterpret_cast<const char *>(&field), sizeof(T));
+        }
+        else if constexpr (is_array<T>::value)
+        {
+            for (const auto &element : field)
+            {
+                value(element);
+            }
+        }
+        else
+        {
+            fields(*this, field);
+        }
+    }
+
+    void value(const string &text)
+    {
+        value(static_cast<uint64_t>(text.size()));
+        out_.write(text.data(), text.size());
+    }
+
+    template <typename T>
+    void value(const vector<T> &list)
+    {
+        value(static_cast<uint64_t>(list.size()));
+        for (const T &element : list)
+        {
+            value(element);
+        }
+    }
+
+    template <typename A, typename B>
+    void value(const pair<A, B> &entry)
+    {
+        value(entry.first);
+        value(entry.second);
+    }
+
+private:
+    ostream &out_;
+};
+
+// Reads the fields of the report state back. A length running past the end of the file marks the file as
+// damaged and everything after it reads as zero
+class StateReader
+{
+public:
+    StateReader(istream &in, uint64_t size) : in_(in), remaining_(size) {}
+
+    bool ok() const { return ok_; }
+
+    template <typename T>
+    void value(T &field)
+    {
+        if constexpr (is_arithmetic<T>::value || is_enum<T>::value)
+        {
+            field = T();
+            read(reinterpret_cast<char *>(&field), sizeof(T));
+        }
+        else if constexpr (is_array<T>::value)
+        {
+            for (auto &element : field)
+            {
+                value(element);
+            }
+        }
+        else
+        {
+            fields(*this, field);
+        }
+    }
+
+    void value(string &text)
+    {
+        text.resize(length());
+        read(&text[0], text.size());
+    }
+
+    // Records are read one at a time: a damaged length then fails at the end of the file instead of
+    // allocating room for records that are not there. Numbers have a fixed size and are checked up front
+    template <typename T>
+    void value(vector<T> &list)
+    {
+        uint64_t size = length();
+        list.clear();
+        if constexpr (is_arithmetic<T>::value || is_enum<T>::value)
+        {
+            if (size > remaining_ / sizeof(T))
+            {
+                ok_ = false;
+                return;
+            }
+            list.reserve(size);
+        }
+        for (uint64_t i = 0; ok_ && i < size; i++)
+        {
+            list.emplace_back();
+            value(list.back());
+        }
+    }
+
+    template <typename A, typename B>
+    void value(pair<A, B> &entry)
+    {
+        value(entry.first);
+        value(entry.second);
+    }
+
+private:
+    uint64_t length()
+    {
+        uint64_t size;
+        value(size);
+        if (size > remaining_)
+        {
+            ok_ = false;
+            return 0;
+        }
+        return size;
+    }
+
+    void read(char *data, uint64_t size)
+    {
+        if (!ok_ || size > remaining_)
+        {
+            ok_ = false;
+            return;
+        }
+        in_.read(data, size);
+        remaining_ -= size;
+        ok_ = static_cast<bool>(in_);
+    }
+
+    istream &in_;
+    uint64_t remaining_;
+    bool ok_ = true;
+};
+
+// Function to visit the fields of a report state record. Writer and reader both go through it, so the two
+// always agree on the file layout
+template <typename Archive, typename Record>
+void fields(Archive &archive, Record &record)
+{
+    using R = remove_const_t<Record>;
+    if constexpr (is_same<R, SourceIdentity>::value)
+    {
+        archive.value(record.size);
+        archive.value(record.mtime_ns);
+        archive.value(record.hash);
+    }
+    else if constexpr (is_same<R, WordFrequency>::value)
+    {
+        archive.value(record.word);
+        archive.value(record.frequency);
+    }
+    else if constexpr (is_same<R, CompanyInfo>::value)
+    {
+        archive.value(record.name);
+        archive.value(record.totalRevenue);
+        archive.value(record.producedCountries);
+    }
+    else if constexpr (is_same<R, QueryResult>::value)
+    {
+        archive.value(record.groups);
+        archive.value(record.aggregates);
+        archive.value(record.states);
+    }
+    else if constexpr (is_same<R, QueryAggregate>::value)
+    {
+        archive.value(record.op);
+        archive.value(record.measure);
+    }
+    else if constexpr (is_same<R, GroupState>::value)
+    {
+        archive.value(record.count);
+        archive.value(record.integer_sum);
+        archive.value(record.integer_min);
+        archive.value(record.integer_max);
+        archive.value(record.sum);
+        archive.value(record.min);
+        archive.value(record.max);
+    }
+    else if constexpr (is_same<R, CorrelationMatrix>::value)
+    {
+        archive.value(record.count);
+        archive.value(record.mean);
+        archive.value(record.comoment);
+    }
+    else if constexpr (is_same<R, TopMovie>::value)
+    {
+        archive.value(record.row);
+        archive.value(record.title);
+        archive.value(record.revenue);
+        archive.value(record.popularity);
+        archive.value(record.companies);
+    }
+    else
+    {
+        static_assert(is_same<R, ReportState>::value, "no fields() for this record");
+        archive.value(record.base);
+        archive.value(record.applied);
+        archive.value(record.rows);
+        archive.value(record.companies);
+        archive.value(record.countries);
+        archive.value(record.genres);
+        archive.value(record.years);
+        archive.value(record.languages);
+        archive.value(record.correlations);
+        archive.value(record.runtimes);
+        archive.value(record.words);
+        archive.value(record.languageWords);
+        archive.value(record.yearWords);
+        archive.value(record.topByRevenue);
+        archive.value(record.topByPopularity);
+    }
+}
+
+// Function to hash the setup the report state depends on: the parser settings and the ignored words and languages
+uint64_t reportConfigHash(const vector<bool> &remove_quotes, const vector<string> &ignoredWords, const vector<string> &ignoredLanguages, ReportSet reports)
+{
+    // A state holding only some reports must not be taken for one holding others
+    uint64_t hash = hashBytes(to_string(reports), parserConfigHash(remove_quotes));
+    for (const vector<string> *list : {&ignoredWords, &ignoredLanguages})
+    {
+        for (const string &word : *list)
+        {
+            hash = hashBytes(word + '\n', hash);
+        }
+        hash = hashBytes("|", hash);
+    }
+    return hash;
+}
+
+// Function to check that every query result of the state holds the aggregates of its query and one state per group.
+// A result of a report that was not selected has neither groups nor aggregates
+bool checkReportState(const ReportState &state)
+{
+    auto checkResult = [](const QueryResult &result, const vector<QueryAggregate> &aggregates)
+    {
+        if (result.aggregates.empty())
+        {
+            return result.states.empty() && result.size() == 0;
+        }
+        bool valid = result.aggregates.size() == aggregates.size() && result.states.size() == aggregates.size();
+        for (size_t a = 0; valid && a < aggregates.size(); a++)
+        {
+            valid = result.aggregates[a].op == aggregates[a].op && result.aggregates[a].measure == aggregates[a].measure &&
+                    result.states[a].size() == result.size();
+        }
+        return valid;
+    };
+    bool valid = checkResult(state.countries, COUNTRY_TOTALS) && checkResult(state.genres, MOVIE_COUNT) &&
+                 checkResult(state.years, MOVIE_COUNT) && checkResult(state.languages, MOVIE_COUNT);
+    for (const vector<WordFrequency> &languageEntry : state.languageWords)
+    {
+        valid = valid && !languageEntry.empty();
+    }
+    return valid;
+}
+
+// Function to write the report state. Like the snapshot it is written next to its final name and renamed into place
+bool saveReportState(const string &path, const ReportState &state, uint64_t config_hash)
+{
+    ProfileScope stage(STAGE_STATE_IO);
+    string temp = path + ".tmp";
+    ofstream out(temp, ios::binary | ios::trunc);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out.write(STATE_MAGIC, sizeof(STATE_MAGIC));
+    StateWriter writer(out);
+    writer.value(STATE_VERSION);
+    writer.value(config_hash);
+    writer.value(state);
+    out.close();
+    if (!out || rename(temp.c_str(), path.c_str()) != 0)
+    {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Function to read a report state. Returns false if the file is missing, damaged or was written with another setup
+bool loadReportState(const string &path, uint64_t config_hash, ReportState &state)
+{
+    ProfileScope stage(STAGE_STATE_IO);
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+    char magic[sizeof(STATE_MAGIC)];
+    if (size < sizeof(magic) || !in.read(magic, sizeof(magic)) || memcmp(magic, STATE_MAGIC, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+    StateReader reader(in, size - sizeof(magic));
+    uint32_t version;
+    uint64_t hash;
+    reader.value(version);
+    reader.value(hash);
+    if (!reader.ok() || version != STATE_VERSION || hash != config_hash)
+    {
+        return false;
+    }
+    ReportState loaded;
+    reader.value(loaded);
+    if (!reader.ok() || !checkReportState(loaded))
+    {
+        return false;
+    }
+    state = move(loaded);
+    return true;
+}
+
+// Function to merge the movies of the appended CSV into the saved report state and save it again. A missing
+// or damaged state is first rebuilt from the full CSV, an appended file that was merged in before is skipped.
+// The state does not keep the appended files, so once any were merged in a change to the base CSV is refused
+// rather than rebuilt: a rebuild would drop their movies, or count them twice if they were copied into the base.
+// Returns false if either CSV cannot be read or the base CSV changed under a state with appended files
+bool appendToState(const Options &options, WorkStealingPool &pool, const vector<bool> &remove_quotes, vector<string> &ignoredLanguages, vector<string> &ignoredWords, uint64_t config_hash, ReportState &state)
+{
+    // The base CSV is only checked by size and modification time, hashing it would read every movie again
+    SourceIdentity base, appended;
+    if (!identifySource(options.filename, base, false))
+    {
+        cerr << "Error opening file: " << options.filename << endl;
+        return false;
+    }
+    if (!identifySource(options.append, appended))
+    {
+        cerr << "Error opening file: " << options.append << endl;
+        return false;
+    }
+
+    bool loaded = loadReportState(options.state, config_hash, state);
+    bool baseChanged = loaded && (state.base.size != base.size || state.base.mtime_ns != base.mtime_ns);
+    if (baseChanged && !state.applied.empty())
+    {
+        cerr << "Error: " << options.filename << " changed since " << state.applied.size() << " appended file(s) were merged into "
+             << options.state << ", remove the state to rebuild it from the CSV files" << endl;
+        return false;
+    }
+    if (!loaded || baseChanged)
+    {
+        if (options.stream)
+        {
+            state = streamReportState(options, pool, remove_quotes, ignoredLanguages, ignoredWords);
+        }
+        else
+        {
+            state = computeReportState(loadMovies(options, pool, remove_quotes, reportColumns(options.reports)), ignoredLanguages, ignoredWords, pool, 0, options.reports);
+        }
+        state.base = base;
+    }
+    if (find(state.applied.begin(), state.applied.end(), appended.hash) != state.applied.end())
+    {
+        cerr << "Warning: " << options.append << " was appended before, its movies are not counted again" << endl;
+        return true;
+    }
+
+    ProfileScope parseStage(STAGE_PARSE);
+    MovieTable movies = loadMovieTable(options.append, remove_quotes, pool, reportColumns(options.reports));
+    parseStage.end();
+    warnInvalidFields(movies, options.append);
+    mergeReportState(state, computeReportState(movies, ignoredLanguages, ignoredWords, pool, state.rows, options.reports));
+    state.applied.push_back(appended.hash);
+    if (!saveReportState(options.state, state, config_hash))
+    {
+        cerr << "Warning: could not write report state " << options.state << endl;
+    }
+    return true;
+}
+
+// Function to print the country with the highest revenue, rating, popularity and movie count
+void printCountryReports(const QueryResult &countries)
+{
+    string countryWithHighestRevenue = findCountryWithHighestProperty(countries, COUNTRY_REVENUE);
+    cout << "Country with the highest revenue: " << countryWithHighestRevenue << endl;
+
+    // Find the country with the highest IMDb rating
+    string countryWithHighestRating = findCountryWithHighestProperty(countries, COUNTRY_RATING);
+    cout << "Country with the highest IMDb rating: " << countryWithHighestRating << endl;
+
+    // Find the country with the highest popularity
+    string countryWithHighestPopularity = findCountryWithHighestProperty(countries, COUNTRY_POPULARITY);
+    cout << "Country with the highest popularity: " << countryWithHighestPopularity << endl;
+
+    // Find the country with the most number of movies
+    string mostProducingCountry = findMostProducingCountry(countries);
+    cout << "Country with the highest total number of movies produced: " << mostProducingCountry << endl;
+
+    cout << "\n"
+         << endl;
+}
+
+// Function to print the correlations between the numeric columns, and the whole matrix if asked for
+void printCorrelations(const CorrelationMatrix &matrix, bool correlationMatrix)
+{
+    if (correlationMatrix)
+    {
+        printCorrelationMatrix(matrix);
+    }
+
+    // Compute correlation coefficients
+    cout << "Correlation between runtime and IMDb rating: " << endl;
+    CorrelationResult runtime_imdb = correlation(matrix, RUNTIME, VOTE_AVERAGE);
+    cout << "Correlation between runtime and popularity: " << endl;
+    CorrelationResult runtime_popularities = correlation(matrix, RUNTIME, POPULARITY);
+    cout << "Correlation between runtime and revenue: " << endl;
+    CorrelationResult runtime_revenues = correlation(matrix, RUNTIME, REVENUE);
+    cout << "Correlation between revenue and popularity: " << endl;
+    CorrelationResult revenue_popularity = correlation(matrix, REVENUE, POPULARITY);
+    cout << "Correlation between imdb_rating and popularity: " << endl;
+    CorrelationResult imdb_rating_popularities = correlation(matrix, VOTE_AVERAGE, POPULARITY);
+    cout << "Correlation between revenue and imdb_rating: " << endl;
+    CorrelationResult revenue_imdb_ratings = correlation(matrix, REVENUE, VOTE_AVERAGE);
+    cout << "Correlation between budget and revenue: " << endl;
+    CorrelationResult budget_revenue = correlation(matrix, BUDGET, REVENUE);
+    cout << "Correlation between budget and runtime: " << endl;
+    CorrelationResult budget_runtime = correlation(matrix, BUDGET, RUNTIME);
+    cout << "Correlation between budget and popularity: " << endl;
+    CorrelationResult budget_popularity = correlation(matrix, BUDGET, POPULARITY);
+    cout << "Correlation between budget and imdb_ratings: " << endl;
+    CorrelationResult budget_imdb_rating = correlation(matrix, BUDGET, VOTE_AVERAGE);
+    cout << "\n"
+         << endl;
+
+    // Output detailed information about correlations
+    cout << "Correlation between runtime and IMDb rating: " << runtime_imdb.correlation_coefficient << endl;
+    cout << "Correlation between runtime and popularity: " << runtime_popularities.correlation_coefficient << endl;
+    cout << "Correlation between runtime and revenue: " << runtime_revenues.correlation_coefficient << endl;
+    cout << "Correlation between revenue and popularity: " << revenue_popularity.correlation_coefficient << endl;
+    cout << "Correlation between revenue and imdb_rating: " << revenue_imdb_ratings.correlation_coefficient << endl;
+    cout << "Correlation between imdb_rating and popularity: " << imdb_rating_popularities.correlation_coefficient << endl;
+    cout << "Correlation between budget and revenue: " << budget_revenue.correlation_coefficient << endl;
+    cout << "Correlation between budget and runtime: " << budget_runtime.correlation_coefficient << endl;
+    cout << "Correlation between budget and popularity: " << budget_popularity.correlation_coefficient << endl;
+    cout << "Correlation between budget and imdb_ratings: " << budget_imdb_rating.correlation_coefficient << endl;
+}
+
+// Function to print the most common title words, overall, by original language and by year
+void printWordReports(const ReportState &state)
+{
+    // Display the top 30 most common words
+    displayTopWords(state.words, 30);
+
+    // Sort the word frequencies of each language entry, most frequent first
+    ProfileScope languageSortStage(STAGE_SORTS);
+    vector<vector<WordFrequency>> titleWordFreqByLanguage = state.languageWords;
+    for (auto &languageEntry : titleWordFreqByLanguage)
+    {
+        // The first entry holds the language itself
+        if (!languageEntry.empty())
+        {
+            sortByKey<ByFrequency, Descending>(languageEntry.data() + 1, languageEntry.data() + languageEntry.size());
+        }
+    }
+    languageSortStage.end();
+
+    // Display word frequencies for each original language
+    displayWordFreqByLanguage(titleWordFreqByLanguage, 5);
+
+    // Display top 5 words in titles segregated by year
+    displayTopWordsByYear(state.yearWords, 25);
+}
+
+// Function to print the selected reports from the report state
+void printReports(const ReportState &state, bool correlationMatrix, ReportSet reports)
+{
+    ProfileScope printStage(STAGE_PRINT);
+    if (reports & REPORT_COMPANIES)
+    {
+        ProfileScope sortStage(STAGE_SORTS);
+        // Select the companies with the highest total revenue
+        vector<uint64_t> topCompanies = topCompaniesByRevenue(state.companies, 10);
+        sortStage.end();
+
+        // Display rge top production companies by revenue
+        displayTopProductionCompanies(state.companies, topCompanies);
+    }
+
+    if (reports & REPORT_COUNTRIES)
+    {
+        printCountryReports(state.countries);
+    }
+    if (reports & REPORT_GENRES)
+    {
+        countAllGenresFrequency(state.genres);
+        cout << "\n"
+             << endl;
+    }
+    if (reports & REPORT_YEARS)
+    {
+        countReleaseYearFrequency(state.years);
+        cout << "\n"
+             << endl;
+    }
+    if (reports & REPORT_CORRELATIONS)
+    {
+        printCorrelations(state.correlations, correlationMatrix);
+    }
+
+    // Displaying language dstribution
+    if (reports & REPORT_LANGUAGES)
+        languageDistribution(state.languages);
+
+    // Displaying runtime distribution
+    if (reports & REPORT_RUNTIME)
+        analyzeRuntimeDistribution(state.runtimes);
+
+    if (reports & REPORT_WORDS)
+    {
+        printWordReports(state);
+    }
+
+    if (reports & REPORT_TOP_MOVIES)
+    {
+        // Print the top 10 movies by revenue
+        printTopMoviesByRevenue(state.topByRevenue, 10);
+
+        // Print the top 10 movies by popularity
+        printTopMoviesByPopularity(state.topByPopularity, 10);
+    }
+}
+
+// Synthetic datasets. Languages, countries, companies, genres and title words are drawn from Zipf
+// distributions, so a few values dominate and a long tail turns up rarely, as in the real data
+class ZipfSampler
+{
+public:
+    ZipfSampler(size_t n, double exponent) : cdf_(n)
+    {
+        double total = 0;
+        for (size_t rank = 0; rank < n; rank++)
+        {
+            total += 1.0 / pow(static_cast<double>(rank + 1), exponent);
+            cdf_[rank] = total;
+        }
+        for (double &probability : cdf_)
+        {
+            probability /= total;
+        }
+    }
+
+    // Function to draw a rank, 0 being the most frequent
+    size_t operator()(mt19937_64 &random) const
+    {
+        double u = uniform_real_distribution<double>(0, 1)(random);
+        size_t rank = static_cast<size_t>(lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+        return min(rank, cdf_.size() - 1);
+    }
+
+private:
+    vector<double> cdf_;
+};
+
+// Function to make up the name of the rank-th value of a vocabulary: the named values first, then
+// pronounceable words built from syllables, optionally behind a prefix
+string syntheticName(const vector<string> &named, size_t rank, const string &prefix = "")
+{
+    if (rank < named.size())
+    {
+        return named[rank];
+    }
+    static const char *const syllables[] = {"ka", "lo", "mi", "ra", "ten", "su", "vo", "ni", "dar", "el", "qui", "po", "zen", "ba", "tor", "ly"};
+    size_t n = rank - named.size() + 16;
+    string name;
+    while (n > 0)
+    {
+        name += syllables[n % 16];
+        n /= 16;
+    }
+    return prefix + name;
+}
+
+// Function to join distinct draws from a sampler into a list field such as "Japan, France"
+string sampleList(const ZipfSampler &sampler, const vector<string> &names, size_t count, mt19937_64 &random)
+{
+    vector<size_t> drawn;
+    for (size_t attempt = 0; drawn.size() < count && attempt < 4 * count; attempt++)
+    {
+        size_t rank = sampler(random);
+        if (find(drawn.begin(), drawn.end(), rank) == drawn.end())
+        {
+            drawn.push_back(rank);
+        }
+    }
+    string list;
+    for (size_t rank : drawn)
+    {
+        list += (list.empty() ? "" : ", ") + names[rank];
+    }
+    return list;
+}
+
+// Function to append a CSV field, quoted when it holds a comma. Generated text never holds a double quote
+void appendField(string &line, const string &field)
+{
+    if (!line.empty())
+    {
+        line += ',';
+    }
+    if (field.find(',') != string::npos)
+    {
+        line += '"' + field + '"';
+    }
+    else
+    {
+        line += field;
+    }
+}
+
+// Function to write a CSV of the given number of movies with the same columns as animated_movies.csv.
+// The vocabularies grow with the row count so larger files also have more distinct companies and words.
+// The same rows and seed always give the same file. Returns false if the file cannot be written
+bool generateMovies(const string &filename, uint64_t rows, uint64_t seed)
+{
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    mt19937_64 random(seed);
+
+    vector<string> languages = {"en", "ja", "fr", "es", "de", "zh", "ko", "ru", "it", "hi", "sv", "da", "pt", "nl", "pl", "cs", "fi", "no", "hu", "tr", "th", "ar", "he", "id", "ta", "te", "fa", "uk", "el", "ro"};
+    vector<string> spokenLanguages = {"English", "Japanese", "French", "Spanish", "German", "Mandarin", "Korean", "Russian", "Italian", "Hindi", "Swedish", "Danish", "Portuguese", "Dutch", "Polish"};
+    vector<string> countries = {"United States of America", "Japan", "France", "United Kingdom", "Canada", "Germany", "China", "South Korea", "Spain", "India", "Italy", "Russia", "Australia", "Belgium", "Denmark", "Sweden", "Brazil", "Mexico", "Netherlands", "Poland", "Czech Republic", "Ireland", "Norway", "Hungary", "Argentina", "Taiwan", "Hong Kong", "Finland", "Switzerland", "Austria"};
+    vector<string> genres = {"Animation", "Family", "Comedy", "Adventure", "Fantasy", "Action", "Drama", "Science Fiction", "Music", "Romance", "Horror", "Mystery", "Documentary", "Thriller", "History", "Crime", "War", "Western", "TV Movie"};
+    vector<string> famousCompanies = {"Walt Disney Pictures", "Pixar", "DreamWorks Animation", "Toei Animation", "Studio Ghibli", "Illumination", "Blue Sky Studios", "Aardman", "Sony Pictures Animation", "Laika", "Warner Bros. Animation", "Nickelodeon Movies", "Cartoon Saloon", "Madhouse", "Production I.G"};
+    vector<string> commonWords = {"The", "of", "a", "and", "the", "Little", "Adventures", "Magic", "Christmas", "Story", "Love", "Night", "Dragon", "King", "Princess", "Journey", "Secret", "World", "Big", "Life", "Moon", "Star", "Hero", "Castle", "Ghost", "Island", "Spirit", "Legend", "Monster", "Ocean", "Sky", "Movie", "in", "to", "Lost", "Last", "New", "Great", "Tale", "Return"};
+
+    size_t companyCount = static_cast<size_t>(max<uint64_t>(100, rows / 20));
+    size_t wordCount = commonWords.size() + static_cast<size_t>(2000 + 20 * sqrt(static_cast<double>(rows)));
+    vector<string> companies(companyCount), words(wordCount);
+    for (size_t rank = 0; rank < companyCount; rank++)
+    {
+        companies[rank] = syntheticName(famousCompanies, rank, "Studio ");
+    }
+    for (size_t rank = 0; rank < wordCount; rank++)
+    {
+        words[rank] = syntheticName(commonWords, rank);
+    }
+    ZipfSampler languageSampler(languages.size(), 1.6), spokenSampler(spokenLanguages.size(), 1.4);
+    ZipfSampler countrySampler(countries.size(), 1.3), genreSampler(genres.size(), 0.8);
+    ZipfSampler companySampler(companyCount, 1.1), wordSampler(wordCount, 1.0);
+
+    normal_distribution<double> runtime(88, 25), rating(6.2, 1.4), logMoney(17, 1.8);
+    exponential_distribution<double> popularity(0.08);
+    uniform_real_distribution<double> unit(0, 1);
+    auto pick = [&](size_t low, size_t high)
+    {
+        return uniform_int_distribution<size_t>(low, high)(random);
+    };
+    auto sentence = [&](size_t count)
+    {
+        string text;
+        for (size_t i = 0; i < count; i++)
+        {
+            text += (i == 0 ? "" : " ") + words[wordSampler(random)];
+        }
+        return text;
+    };
+
+    string buffer = "id,title,vote_average,vote_count,status,release_date,revenue,runtime,adult,backdrop_path,budget,homepage,imdb_id,original_language,original_title,overview,popularity,poster_path,tagline,genres,production_companies,production_countries,spoken_languages\n";
+    char number[32];
+    for (uint64_t id = 0; id < rows; id++)
+    {
+        string title = sentence(pick(1, 5));
+        if (unit(random) < 0.1)
+        {
+            title += ": " + sentence(pick(1, 3));
+        }
+        // Release years lean towards recent decades
+        int year = 2026 - static_cast<int>(115 * pow(unit(random), 1.8));
+        double money = unit(random) < 0.7 ? 0 : exp(logMoney(random));
+        double budget = unit(random) < 0.6 ? 0 : exp(logMoney(random) - 0.5);
+        int votes = static_cast<int>(exp(unit(random) * 10));
+
+        string line;
+        appendField(line, to_string(id));
+        appendField(line, title);
+        snprintf(number, sizeof(number), "%.3f", min(10.0, max(0.0, rating(random))));
+        appendField(line, number);
+        appendField(line, to_string(votes));
+        appendField(line, unit(random) < 0.95 ? "Released" : "In Production");
+        appendField(line, to_string(pick(1, 12)) + "/" + to_string(pick(1, 28)) + "/" + to_string(year));
+        appendField(line, to_string(static_cast<long long>(money)));
+        appendField(line, to_string(max(0, static_cast<int>(runtime(random)))));
+        appendField(line, unit(random) < 0.99 ? "False" : "True");
+        appendField(line, "/backdrop" + to_string(id) + ".jpg");
+        appendField(line, to_string(static_cast<long long>(budget)));
+        appendField(line, "");
+        appendField(line, "tt" + to_string(1000000 + id));
+        appendField(line, languages[languageSampler(random)]);
+        appendField(line, title);
+        appendField(line, sentence(pick(8, 40)) + ", " + sentence(pick(4, 20)));
+        snprintf(number, sizeof(number), "%.3f", popularity(random));
+        appendField(line, number);
+        appendField(line, "/poster" + to_string(id) + ".jpg");
+        appendField(line, unit(random) < 0.5 ? "" : sentence(pick(3, 8)));
+        appendField(line, sampleList(genreSampler, genres, pick(1, 3), random));
+        appendField(line, sampleList(companySampler, companies, pick(1, 3), random));
+        appendField(line, sampleList(countrySampler, countries, pick(1, 2), random));
+        appendField(line, sampleList(spokenSampler, spokenLanguages, pick(1, 2), random));
+        buffer += line;
+        buffer += '\n';
+        if (buffer.size() >= (1 << 20))
+        {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), buffer.size());
+    out.close();
+    return static_cast<bool>(out);
+}
+
+// Times one benchmark after another and writes the results as one JSON document
+class BenchmarkRunner
+{
+public:
+    explicit BenchmarkRunner(unsigned repeat) : repeat_(max(1u, repeat)) {}
+
+    // Function to time work repeat times, each time on a fresh copy of input made outside the timing.
+    // work returns a number derived from its result so the compiler cannot drop the work
+    template <typename Input, typename Work>
+    void run(const string &name, const Input &input, Work work)
+    {
+        vector<double> seconds;
+        for (unsigned r = 0; r < repeat_; r++)
+        {
+            Input copy = input;
+            auto start = chrono::steady_clock::now();
+            sink_ += static_cast<uint64_t>(work(copy));
+            seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+        }
+        sort(seconds.begin(), seconds.end());
+        results_.push_back({name, seconds.front(), seconds[seconds.size() / 2], seconds.back()});
+        cerr << name << ": " << seconds[seconds.size() / 2] * 1000 << " ms" << endl;
+    }
+
+    template <typename Work>
+    void run(const string &name, Work work)
+    {
+        run(name, 0, [&](int &)
+        {
+            return work();
+        });
+    }
+
+    // Function to write the results. Times are in seconds; the run is described by rows, threads and kernels
+    void write(ostream &out, uint64_t rows, unsigned threads) const
+    {
+        out << "{\n  \"rows\": " << rows << ",\n  \"threads\": " << threads << ",\n  \"simd\": \"" << statKernels().name
+            << "\",\n  \"repeat\": " << repeat_ << ",\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); i++)
+        {
+            const Result &result = results_[i];
+            out << "    {\"name\": \"" << result.name << "\", \"min_s\": " << result.min << ", \"median_s\": " << result.median
+                << ", \"max_s\": " << result.max << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}" << endl;
+    }
+
+private:
+    struct Result
+    {
+        string name;
+        double min;
+        double median;
+        double max;
+    };
+
+    unsigned repeat_;
+    vector<Result> results_;
+    volatile uint64_t sink_ = 0;
+};
+
+// Function to run the micro benchmarks of every parse, sort, aggregation and correlation step and the macro
+// benchmarks of whole runs on the CSV, then write the JSON results to options.bench_output or standard output
+int runBenchmarks(const Options &options, WorkStealingPool &pool, const vector<bool> &remove_quotes, vector<string> &ignoredLanguages, vector<string> &ignoredWords)
+{
+    BenchmarkRunner bench(options.bench_repeat);
+    WorkStealingPool serial(1);
+    const string &csv = options.filename;
+
+    bench.run("parse/parseCSV", [&]()
     {
-        if (!movie.release_date.empty())
+        return readCSV<MovieRows>(csv, remove_quotes, serial).size();
+    });
+    bench.run("parse/loadMovieTable", [&]()
+    {
+        return loadMovieTable(csv, remove_quotes, serial).size();
+    });
+    bench.run("parse/loadMovieTable_threads", [&]()
+    {
+        return loadMovieTable(csv, remove_quotes, pool).size();
+    });
+    bench.run("parse/loadMovieTable_revenue_only", [&]()
+    {
+        return loadMovieTable(csv, remove_quotes, serial, columnBit(CSV_REVENUE)).size();
+    });
+    bench.run("parse/loadMovieTable_top_movies", [&]()
+    {
+        return loadMovieTable(csv, remove_quotes, serial, reportColumns(REPORT_TOP_MOVIES)).size();
+    });
+    MovieTable movies = loadMovieTable(csv, remove_quotes, pool);
+    if (movies.size() == 0)
+    {
+        cerr << "Error: no movies in " << csv << endl;
+        return 1;
+    }
+
+    // Aggregations
+    vector<CompanyInfo> companies;
+    bench.run("aggregate/processCompanyInfo", [&]()
+    {
+        companies = processCompanyInfo(movies);
+        return companies.size();
+    });
+    const pair<const char *, GroupKey> keys[] = {{"language", GroupKey::Language}, {"year", GroupKey::Year}, {"country", GroupKey::Country}, {"company", GroupKey::Company}, {"genre", GroupKey::Genre}};
+    for (const auto &key : keys)
+    {
+        bench.run(string("aggregate/groupBy_") + key.first, [&]()
+        {
+            return groupBy(movies, key.second, MOVIE_COUNT).size();
+        });
+    }
+    bench.run("aggregate/country_totals", [&]()
+    {
+        return groupBy(movies, GroupKey::Country, COUNTRY_TOTALS).size();
+    });
+    bench.run("aggregate/runtimeHistogram", [&]()
+    {
+        return runtimeHistogram(movies).size();
+    });
+    bench.run("aggregate/YearIndex", [&]()
+    {
+        return YearIndex(movies).rowsBetween(movies.released, 20000101, 20091231).size();
+    });
+    bench.run("words/TitleIndex", [&]()
+    {
+        return TitleIndex(movies.title, pool).rows;
+    });
+    TitleIndex titleIndex(movies.title, pool);
+    vector<WordFrequency> words;
+    vector<pair<int, vector<WordFrequency>>> yearWords;
+    bench.run("words/countWords", [&]()
+    {
+        words = countWords(titleIndex, ignoredWords, pool);
+        return words.size();
+    });
+    bench.run("words/countTitleWordsByOriginalLanguage", [&]()
+    {
+        return countTitleWordsByOriginalLanguage(movies, titleIndex, ignoredLanguages, ignoredWords, pool).size();
+    });
+    bench.run("words/countTitleWordsByYear", [&]()
+    {
+        yearWords = countTitleWordsByYear(movies, titleIndex, ignoredWords, pool);
+        return yearWords.size();
+    });
+
+    // Correlations
+    CorrelationMatrix matrix;
+    bench.run("correlation/computeCorrelationMatrix", [&]()
+    {
+        matrix = computeCorrelationMatrix(movies, pool);
+        return matrix.count;
+    });
+    bench.run("correlation/correlationOf_all_pairs", [&]()
+    {
+        double total = 0;
+        for (int x = 0; x < CORRELATION_COLUMNS; x++)
+        {
+            for (int y = 0; y < CORRELATION_COLUMNS; y++)
+            {
+                total += correlationOf(matrix, static_cast<CorrelationColumn>(x), static_cast<CorrelationColumn>(y)).correlation_coefficient;
+            }
+        }
+        return total != 0;
+    });
+
+    // Sorts, every one on a fresh copy of its input
+    bench.run("sort/sortViewByColumn_revenue", [&]()
+    {
+        return sortViewByColumn<&MovieTable::revenue>(TableView(movies), &pool).size();
+    });
+    bench.run("sort/sortViewByColumn_popularity", [&]()
+    {
+        return sortViewByColumn<&MovieTable::popularity>(TableView(movies), &pool).size();
+    });
+    bench.run("sort/topMoviesByRevenue", [&]()
+    {
+        return topMoviesByRevenue(movies, TOP_MOVIES).size();
+    });
+    bench.run("sort/mergeSortCompanies", [&]()
+    {
+        return mergeSortCompanies(companies, &pool).size();
+    });
+    vector<pair<string, long long>> companyRevenue;
+    for (const CompanyInfo &company : companies)
+    {
+        companyRevenue.emplace_back(company.name, company.totalRevenue);
+    }
+    bench.run("sort/sortByKey_company_revenue", companyRevenue, [&](vector<pair<string, long long>> &pairs)
+    {
+        sortByKey<ByMember<&pair<string, long long>::second>, Descending>(pairs, &pool);
+        return pairs.size();
+    });
+    vector<string> titles;
+    for (size_t row = 0; row < movies.size(); row++)
+    {
+        titles.emplace_back(movies.title[row]);
+    }
+    bench.run("sort/sortByKey_titles", titles, [&](vector<string> &strings)
+    {
+        sortByKey<Identity, Ascending>(strings, &pool);
+        return strings.size();
+    });
+    bench.run("sort/sortByKey_words", words, [&](vector<WordFrequency> &wordFreq)
+    {
+        sortByKey<ByFrequency, Descending>(wordFreq, &pool);
+        return wordFreq.size();
+    });
+    bench.run("sort/sortByKey_years", yearWords, [&](vector<pair<int, vector<WordFrequency>>> &years)
+    {
+        sortByKey<ByMember<&pair<int, vector<WordFrequency>>::first>, Descending>(years, &pool);
+        return years.size();
+    });
+    vector<string> vocabulary;
+    for (const WordFrequency &wf : words)
+    {
+        vocabulary.push_back(wf.word);
+    }
+    bench.run("sort/bucketSort_words", vocabulary, [](vector<string> &strings)
+    {
+        bucketSort(strings);
+        return strings.size();
+    });
+
+    // Whole runs without the printing
+    bench.run("macro/load_and_report_state", [&]()
+    {
+        return computeReportState(loadMovieTable(csv, remove_quotes, pool), ignoredLanguages, ignoredWords, pool, 0, ALL_REPORTS).rows;
+    });
+    bench.run("macro/stream_report_state", [&]()
+    {
+        return streamReportState(options, pool, remove_quotes, ignoredLanguages, ignoredWords).rows;
+    });
+
+    if (options.bench_output.empty())
+    {
+        bench.write(cout, movies.size(), pool.size());
+        return 0;
+    }
+    ofstream out(options.bench_output);
+    bench.write(out, movies.size(), pool.size());
+    return out ? 0 : 1;
+}
+
+// Resident server. The movies are loaded once and every answer is read from structures built at startup,
+// so a request costs a lookup plus the formatting of its answer. The table and state are never modified
+// after construction, which lets any number of workers answer at the same time without locking
+class ReportServer
+{
+public:
+    ReportServer(const MovieTable &table, const ReportState &state, WorkStealingPool &pool) : table_(table), yearIndex_(table)
+    {
+        byRevenue_ = sortViewByColumn<&MovieTable::revenue>(TableView(table), &pool).rows();
+
+        ostringstream languages;
+        for (size_t g = 0; g < state.languages.size(); ++g)
+        {
+            languages << state.languages.groups[g] << ": " << state.languages.integerValue(g) << " movies\n";
+        }
+        languages_ = languages.str();
+
+        // Years ascending for the lookup, the words of every year most frequent first
+        vector<pair<int, vector<WordFrequency>>> yearWords = state.yearWords;
+        sortByKey<ByMember<&pair<int, vector<WordFrequency>>::first>, Ascending>(yearWords, &pool);
+        for (pair<int, vector<WordFrequency>> &year : yearWords)
+        {
+            sortByKey<ByFrequency, Descending>(year.second, &pool);
+            years_.push_back(year.first);
+            yearWords_.push_back(move(year.second));
+        }
+    }
+
+    // Function to answer one request line. Requests are
+    //   top-revenue [n]        the n movies with the highest revenue, 10 by default
+    //   languages              the number of movies in every original language
+    //   year-words <year> [n]  the n most common title words of a release year, 10 by default
+    //   released <from> <to> [n]
+    //                          the number of movies released between two dates, both included, and the n with
+    //                          the highest revenue among them, 10 by default. A date is a year or a full date
+    // n runs from 1 to the number of movies. The answer is one or more lines, an unknown or malformed request,
+    // including one with words after its last argument, gets a line starting with "error:"
+    string answer(const string &request) const
+    {
+        istringstream words(request);
+        string command;
+        words >> command;
+        ostringstream out;
+        size_t n;
+        if (command == "top-revenue")
+        {
+            if (!readCount(words, n))
+            {
+                return "error: top-revenue takes one optional count from 1 to " + to_string(table_.size()) + "\n";
+            }
+            for (size_t i = 0; i < min(n, byRevenue_.size()); i++)
+            {
+                uint64_t row = byRevenue_[i];
+                out << "Title: " << table_.title[row] << " - Revenue: $" << table_.revenue[row] << "\n";
+            }
+        }
+        else if (command == "languages")
         {
-            // Extract the substring representing the year by iterating backward from the end of the string
-            string yearString;
-            int lastIndex = movie.release_date.size() - 1;
-            for (int i = lastIndex; i >= 0; --i)
+            string extra;
+            if (words >> extra)
             {
-                if (movie.release_date[i] == '/')
-                {
-                    break; // Stop when encountering the first '/'
-                }
-                yearString = movie.release_date[i] + yearString; // Prepend the character to the yearString
+                return "error: languages takes no arguments\n";
             }
-
-            // Convert the year string to an integer
-            int releaseYear = stoi(yearString);
-            // Check if the release year is not in the excluded years list
-            bool isExcluded = false;
-            for (int year : excludedYears)
+            out << languages_;
+        }
+        else if (command == "year-words")
+        {
+            int year;
+            if (!(words >> year))
             {
-                if (year == releaseYear)
-                {
-                    isExcluded = true;
-                    break;
-                }
+                return "error: year-words needs a year\n";
             }
-
-            if (!isExcluded)
+            if (!readCount(words, n))
             {
-                // Find or create an entry for the release year
-                bool foundYear = false;
-                for (auto &yearEntry : yearTitleWordFreq)
-                {
-                    if (yearEntry.first == releaseYear)
-                    {
-                        foundYear = true;
-                        // Process the movie title and update word frequencies for the release year
-                        for (const auto &word : split(movie.title, ' '))
-                        {
-                            // Convert word to lowercase and remove leading/trailing punctuation marks
-                            string lowercaseWord;
-                            for (char c : word)
-                            {
-                                if (isalnum(c)) // Check if the character is alphanumeric
-                                {
-                                    lowercaseWord += tolower(c); // Convert to lowercase
-                                }
-                                else if (!lowercaseWord.empty()) // Only append non-leading/trailing punctuation
-                                {
-                                    break;
-                                }
-                            }
-
-                            // Check if the lowercase word is not in the list of ignored words
-                            if (!binarySearch(ignoredWords, lowercaseWord) && !lowercaseWord.empty())
-                            {
-                                // Find the word frequency entry for the current word in the release year
-                                bool foundWord = false;
-                                for (auto &wf : yearEntry.second)
-                                {
-                                    if (wf.word == lowercaseWord)
-                                    {
-                                        wf.frequency++;
-                                        foundWord = true;
-                                        break;
-                                    }
-                                }
-                                if (!foundWord)
-                                {
-                                    // If the word doesn't exist, add it with frequency 1
-                                    yearEntry.second.push_back({lowercaseWord, 1});
-                                }
-                            }
-                        }
-                        break;
-                    }
-                }
-
-                if (!foundYear)
-                {
-                    // Create a new entry for the release year
-                    vector<WordFrequency> wordFreq;
-                    for (const auto &word : split(movie.title, ' '))
-                    {
-                        // Convert word to lowercase and remove leading/trailing punctuation marks
-                        string lowercaseWord;
-                        for (char c : word)
-                        {
-                            if (isalnum(c)) // Check if the character is alphanumeric
-                            {
-                                lowercaseWord += tolower(c); // Convert to lowercase
-                            }
-                            else if (!lowercaseWord.empty()) // Only append non-leading/trailing punctuation
-                            {
-                                break;
-                            }
-                        }
-
-                        // Check if the lowercase word is not in the list of ignored words
-                        if (!binarySearch(ignoredWords, lowercaseWord) && !lowercaseWord.empty())
-                        {
-                            // Find the word frequency entry for the current word in the release year
-                            bool foundWord = false;
-                            for (auto &wf : wordFreq)
-                            {
-                                if (wf.word == lowercaseWord)
-                                {
-                                    wf.frequency++;
-                                    foundWord = true;
-                                    break;
-                                }
-                            }
-                            if (!foundWord)
-                            {
-                                // If the word doesn't exist, add it with frequency 1
-                                wordFreq.push_back({lowercaseWord, 1});
-                            }
-                        }
-                    }
-                    yearTitleWordFreq.push_back({releaseYear, wordFreq});
-                }
+                return "error: year-words takes one optional count from 1 to " + to_string(table_.size()) + "\n";
+            }
+            auto found = lower_bound(years_.begin(), years_.end(), year);
+            if (found == years_.end() || *found != year)
+            {
+                return "error: no titles counted for " + to_string(year) + "\n";
+            }
+            const vector<WordFrequency> &wordFreq = yearWords_[found - years_.begin()];
+            for (size_t i = 0; i < min(n, wordFreq.size()); i++)
+            {
+                out << wordFreq[i].word << ": " << wordFreq[i].frequency << " occurrences\n";
+            }
+        }
+        else if (command == "released")
+        {
+            string fromText, toText;
+            words >> fromText >> toText;
+            int32_t from = parseReleaseDate(fromText), to = parseReleaseDate(toText);
+            if (from == 0 || to == 0)
+            {
+                return "error: released needs two dates\n";
             }
+            if (!readCount(words, n))
+            {
+                return "error: released takes one optional count from 1 to " + to_string(table_.size()) + "\n";
+            }
+            // A bare year as the end of the range takes in the whole year
+            if (to % 10000 == 0)
+            {
+                to += 1231;
+            }
+            vector<uint64_t> rows = yearIndex_.rowsBetween(table_.released, from, to);
+            out << rows.size() << " movies\n";
+            vector<uint64_t> top = topK(rows.size(), n, [&](uint64_t a, uint64_t b)
+                                        { return table_.revenue[rows[a]] > table_.revenue[rows[b]]; });
+            for (uint64_t i : top)
+            {
+                out << "Title: " << table_.title[rows[i]] << " - Revenue: $" << table_.revenue[rows[i]] << "\n";
+            }
+        }
+        else
+        {
+            return "error: unknown request '" + command + "'\n";
         }
+        return out.str();
     }
 
-    return yearTitleWordFreq;
-}
-
-// Function to sort word frequencies for each year entry using quick sort
-void sortWordFrequenciesByYear(vector<pair<int, vector<WordFrequency>>> &yearTitleWordFreq)
-{
-    for (auto &yearEntry : yearTitleWordFreq)
+private:
+    // Function to read the optional count that ends a request, 10 when it is left out. Returns false if it is
+    // not a whole number from 1 to the number of movies or if more words follow it
+    bool readCount(istringstream &words, size_t &n) const
     {
-        mergeSort(yearEntry.second, 0, yearEntry.second.size() - 1);
+        n = 10;
+        string text, extra;
+        if (!(words >> text))
+        {
+            return true;
+        }
+        long long value;
+        const char *last = text.data() + text.size();
+        from_chars_result result = from_chars(text.data(), last, value);
+        if (result.ec != errc() || result.ptr != last || value <= 0 || static_cast<uint64_t>(value) > table_.size() || words >> extra)
+        {
+            return false;
+        }
+        n = static_cast<size_t>(value);
+        return true;
     }
-}
 
-void displayTopWordsByYear(vector<pair<int, vector<WordFrequency>>> &yearTitleWordFreq, int numYears)
-{
-    int yearsDisplayed = 0;
+    const MovieTable &table_;
+    YearIndex yearIndex_;
+    vector<uint64_t> byRevenue_;            // Every row, highest revenue first
+    string languages_;                      // Language distribution, formatted once
+    vector<int> years_;                     // Release years with counted title words, ascending
+    vector<vector<WordFrequency>> yearWords_; // Words of years_[i], most frequent first
+};
 
-    // Sort the years in descending order
-    mergeSortInt(yearTitleWordFreq, 0, yearTitleWordFreq.size() - 1);
+// A connected client and the start of a request line it has not finished sending
+struct ClientConnection
+{
+    int fd;
+    string pending;
+};
 
-    cout << "Top 10 words in movie titles segregated by year:" << endl;
-    for (const auto &yearEntry : yearTitleWordFreq)
+// Function to read what a client has sent and answer every complete request line, one request per line.
+// Every answer is followed by an empty line so the client knows where it ends. Returns false once the
+// client has disconnected or stopped reading its answers
+bool serveRequests(ClientConnection &client, const ReportServer &server)
+{
+    char buffer[4096];
+    ssize_t received = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (received < 0)
     {
-        cout << "Year: " << yearEntry.first << endl;
-        int count = 0;
-        for (const auto &wf : yearEntry.second)
+        return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (received == 0)
+    {
+        return false;
+    }
+    client.pending.append(buffer, static_cast<size_t>(received));
+    size_t end;
+    while ((end = client.pending.find('\n')) != string::npos)
+    {
+        string request = client.pending.substr(0, end);
+        client.pending.erase(0, end + 1);
+        if (!request.empty() && request.back() == '\r')
         {
-            cout << wf.word << ": " << wf.frequency << " occurrences" << endl;
-            count++;
-            if (count >= 10)
-                break;
+            request.pop_back();
         }
-        cout << "--------------------------" << endl;
-
-        yearsDisplayed++;
-        if (yearsDisplayed >= numYears)
+        string reply = server.answer(request) + "\n";
+        for (size_t sent = 0; sent < reply.size();)
         {
-            break; // Stop displaying years after the specified number of years
+            ssize_t written = send(client.fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0)
+            {
+                return false;
+            }
+            sent += static_cast<size_t>(written);
         }
     }
+    return true;
 }
 
-void displayTopWords(const vector<WordFrequency> &wordFreq, int limit)
+// Seconds a client may leave an answer unread before it is dropped
+const int CLIENT_SEND_TIMEOUT = 5;
+
+// Function to serve requests on a Unix domain socket until accepting or polling fails. The main thread polls
+// the listener and every idle client; a client with input waiting is queued for a fixed pool of workers, and
+// the worker that takes it answers the requests it has sent and hands it back to be polled again. A worker is
+// only held while it answers, so idle clients cannot keep others waiting. Returns 1
+int serve(const string &path, const ReportServer &server, unsigned workers)
 {
-    cout << "Top " << limit << " most common words in movie titles:" << endl;
-    int count = 0;
-    for (const auto &wf : wordFreq)
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
     {
-        cout << wf.word << ": " << wf.frequency << " occurrences" << endl;
-        count++;
-        if (count >= limit)
-            break;
+        cerr << "Error: socket path too long: " << path << endl;
+        return 1;
     }
-}
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
 
-void displayWordFreqByLanguage(const vector<vector<WordFrequency>> &titleWordFreqByLanguage, int limit)
-{
-    cout << "Word frequencies in movie taglines according to original language (excluding ignored languages):" << endl;
-    for (const auto &languageEntry : titleWordFreqByLanguage)
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    // Workers write to the pipe when they hand a client back, which wakes the poll
+    int wake[2] = {-1, -1};
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0 || pipe(wake) != 0)
     {
-        cout << "Original Language: " << languageEntry[0].word << endl;
-        for (size_t i = 1; i < min(languageEntry.size(), static_cast<size_t>(limit + 1)); i++) // Display top 'limit' words
+        cerr << "Error: cannot listen on " << path << ": " << strerror(errno) << endl;
+        for (int fd : {listener, wake[0], wake[1]})
         {
-            cout << languageEntry[i].word << ": " << languageEntry[i].frequency << endl;
+            if (fd >= 0)
+            {
+                close(fd);
+            }
         }
-        cout << "--------------------------" << endl;
+        return 1;
     }
-}
 
-void displayTopProductionCompanies(const vector<CompanyInfo> &companies)
-{
-    cout << "Top 10 Production Companies by Total Revenue:\n";
-    int count = 0;
-    for (const CompanyInfo &company : companies)
+    mutex lock;
+    condition_variable ready;
+    deque<ClientConnection> queued;    // Clients with input waiting for a worker
+    vector<ClientConnection> returned; // Clients the workers handed back since the last poll
+    bool stop = false;
+    vector<thread> pool;
+    for (unsigned w = 0; w < max(1u, workers); w++)
     {
-        if (count >= 10)
-            break;
-        cout << company.name << " - Total Revenue: $" << company.totalRevenue << ", Produced Countries: ";
-        for (size_t i = 0; i < company.producedCountries.size(); ++i)
+        pool.emplace_back([&]()
         {
-            cout << company.producedCountries[i];
-            if (i != company.producedCountries.size() - 1)
+            while (true)
             {
-                cout << ", ";
+                unique_lock<mutex> guard(lock);
+                ready.wait(guard, [&]()
+                {
+                    return stop || !queued.empty();
+                });
+                if (stop)
+                {
+                    return;
+                }
+                ClientConnection client = move(queued.front());
+                queued.pop_front();
+                guard.unlock();
+                if (!serveRequests(client, server))
+                {
+                    close(client.fd);
+                    continue;
+                }
+                guard.lock();
+                returned.push_back(move(client));
+                guard.unlock();
+                char signal = 0;
+                ssize_t written = write(wake[1], &signal, 1);
+                (void)written;
             }
-        }
-        cout << endl;
-        count++;
+        });
     }
-}
 
-void printTopMoviesByRevenue(const vector<Movie> &movies, int limit)
-{
-    cout << "Top " << limit << " Movie Titles with Highest Revenue and Their Production Companies:\n";
-    int count = 0;
-    for (const Movie &movie : movies)
+    cerr << "Serving on " << path << " with " << pool.size() << " workers" << endl;
+    vector<ClientConnection> idle;
+    vector<pollfd> polled;
+    while (true)
     {
-        if (count >= limit)
-            break;
-        cout << "Title: " << movie.title << " - Revenue: $" << movie.revenue << endl;
-        cout << "Production Company: ";
-        for (const string &company : movie.production_companies)
+        polled.assign({{listener, POLLIN, 0}, {wake[0], POLLIN, 0}});
+        for (const ClientConnection &client : idle)
         {
-            cout << company << ", ";
+            polled.push_back({client.fd, POLLIN, 0});
         }
-        cout << endl
-             << endl;
-        count++;
-    }
-}
-
-void printTopMoviesByPopularity(const vector<Movie> &movies, int limit)
-{
-    cout << "Top " << limit << " Movie Titles with Highest Popularity and Their Production Companies:\n";
-    int count = 0;
-    for (const Movie &movie : movies)
-    {
-        if (count >= limit)
-            break;
-        cout << "Title: " << movie.title << " - Popularity: $" << movie.popularity << endl;
-        cout << "Production Company: ";
-        for (const string &company : movie.production_companies)
+        if (poll(polled.data(), polled.size(), -1) < 0)
         {
-            cout << company << ", ";
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            cerr << "Error: poll failed: " << strerror(errno) << endl;
+            break;
         }
-        cout << endl
-             << endl;
-        count++;
-    }
-}
 
-void languageDistribution(const vector<Movie> &movies)
-{
-    vector<string> languages;
-    vector<int> languageCount;
+        // Queue the clients with input or a hang-up waiting, keep polling the others
+        vector<ClientConnection> stillIdle;
+        {
+            lock_guard<mutex> guard(lock);
+            for (size_t i = 0; i < idle.size(); i++)
+            {
+                if (polled[i + 2].revents != 0)
+                {
+                    queued.push_back(move(idle[i]));
+                }
+                else
+                {
+                    stillIdle.push_back(move(idle[i]));
+                }
+            }
+        }
+        idle = move(stillIdle);
+        ready.notify_all();
 
-    // Iterate through the movies to count language frequency
-    for (const auto &movie : movies)
-    {
-        bool languageFound = false;
-        for (size_t i = 0; i < languages.size(); ++i)
+        if (polled[1].revents != 0)
         {
-            if (movie.original_language == languages[i])
+            char signals[64];
+            ssize_t drained = read(wake[0], signals, sizeof(signals));
+            (void)drained;
+            lock_guard<mutex> guard(lock);
+            for (ClientConnection &client : returned)
             {
-                languageCount[i]++;
-                languageFound = true;
-                break;
+                idle.push_back(move(client));
             }
+            returned.clear();
         }
-        if (!languageFound)
+        if (polled[0].revents != 0)
         {
-            languages.push_back(movie.original_language);
-            languageCount.push_back(1);
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+                cerr << "Error: accept failed: " << strerror(errno) << endl;
+                break;
+            }
+            timeval timeout = {CLIENT_SEND_TIMEOUT, 0};
+            setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            idle.push_back(ClientConnection{client, string()});
         }
     }
 
-    // Display language distribution
-    cout << "Language Distribution:" << endl;
-    for (size_t i = 0; i < languages.size(); ++i)
+    // Stop the workers before the state they share goes away, then drop every client
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    ready.notify_all();
+    for (thread &worker : pool)
+    {
+        worker.join();
+    }
+    for (vector<ClientConnection> *clients : {&idle, &returned})
+    {
+        for (const ClientConnection &client : *clients)
+        {
+            close(client.fd);
+        }
+    }
+    for (const ClientConnection &client : queued)
     {
-        cout << languages[i] << ": " << languageCount[i] << " movies \n";
+        close(client.fd);
     }
+    close(wake[0]);
+    close(wake[1]);
+    close(listener);
+    unlink(path.c_str());
+    return 1;
 }
 
-int main()
+// Function to do what the options ask for and return the exit status
+int run(Options &options)
 {
     // Vector to define which columns need to have the double quotes removed and which do not
     vector<bool> remove_quotes = {false, false, true, true, false, false, true, true, false, false, true, false, false, false, false, false, false, false, false, false, false, false};
-    vector<Movie> movies = parseCSV("animated_movies.csv", remove_quotes);
     // Words to ignore while doing word frequency analysis
     vector<string> ignoredWords = {"&", "-", "1", "2", "3", "a", "about", "al", "all", "an", "and", "animation", "as", "at", "au", "b", "d", "da", "das", "de", "dei", "del", "della", "der", "des", "di", "die", "do", "du", "e", "el", "elle", "en", "entre", "et", "f", "for", "from", "g", "gli", "go", "have", "how", "i", "il", "in", "is", "it", "k", "l", "la", "las", "le", "les", "los", "m", "movie", "my", "ni", "no", "o", "of", "on", "one", "os", "r", "seven", "t", "the", "there", "to", "un", "una", "und", "v", "ve", "was", "what", "who", "with", "y", "you", "your", "z"};
     // Vector of original languages to be ignored
     vector<string>
         ignoredLanguages = {"oc", "ab", "id", "mr", "la", "ar", "ms", "pa", "sk", "el", "bs", "ga", "tl", "cn", "kk", "is", "si", "st", "mo", "hy", "th", "as", "gl", "ur", "sw", "mn", "be", "he", "nb", "iu", "zu", "lt", "qu", "ta", "vi", "yi", "ca", "af", "ro", "ml", "uz", "cy", "mi", "ht", "sr", "ka", "fa", "eu", "cr", "kk", "ha", "bn", "dz", "nn", "os", "te", "bg", "mk", "sq", "si", "sl", "gn", "pa", "ku", "sa"};
-    // Find the total revenue for each production company
-    vector<CompanyInfo> companies = processCompanyInfo(movies);
-
-    // Sort companies based on total revenue
-    mergeSortCompanies(companies);
-
-    // Display rge top production companies by revenue
-    displayTopProductionCompanies(companies);
-
-    // Find the country with the highest revenue
-    string countryWithHighestRevenue = findCountryWithHighestProperty(movies, &Movie::revenue);
-    cout << "Country with the highest revenue: " << countryWithHighestRevenue << endl;
-
-    // Find the country with the highest IMDb rating
-    string countryWithHighestRating = findCountryWithHighestProperty(movies, &Movie::vote_average);
-    cout << "Country with the highest IMDb rating: " << countryWithHighestRating << endl;
-
-    // Find the country with the highest popularity
-    string countryWithHighestPopularity = findCountryWithHighestProperty(movies, &Movie::popularity);
-    cout << "Country with the highest popularity: " << countryWithHighestPopularity << endl;
-
-    // Find the country with the most number of movies
-    string mostProducingCountry = findMostProducingCountry(movies);
-    cout << "Country with the highest total number of movies produced: " << mostProducingCountry << endl;
-
-    cout << "\n"
-         << endl;
-    countAllGenresFrequency(movies);
-    cout << "\n"
-         << endl;
-    countReleaseYearFrequency(movies);
-    cout << "\n"
-         << endl;
-
-    // Extract data for analysis
-    vector<float> imdb_ratings;
-    vector<int> runtimes;
-    vector<long long> revenues;
-    vector<float> popularities;
-    vector<string> genres;
-    vector<long long> budget;
 
-    for (const auto &movie : movies)
+    // Write a synthetic dataset, and benchmark on it if --bench is given too
+    if (options.generate_rows > 0)
     {
-        imdb_ratings.push_back(movie.vote_average);
-        revenues.push_back(movie.revenue);
-        budget.push_back(movie.budget);
-        popularities.push_back(movie.popularity);
-        genres.push_back(movie.genres.empty() ? "" : movie.genres[0]); // Assuming only one genre per movie for simplicity
+        if (!generateMovies(options.generate_file, options.generate_rows, options.seed))
+        {
+            cerr << "Error: could not write " << options.generate_file << endl;
+            return 1;
+        }
+        if (!options.bench)
+        {
+            return 0;
+        }
+        options.filename = options.generate_file;
     }
-
-    // Compute correlation coefficients
-    cout << "Correlation between runtime and IMDb rating: " << endl;
-    CorrelationResult runtime_imdb = correlation(runtimes, imdb_ratings);
-    cout << "Correlation between runtime and popularity: " << endl;
-    CorrelationResult runtime_popularities = correlation(runtimes, popularities);
-    cout << "Correlation between runtime and revenue: " << endl;
-    CorrelationResult runtime_revenues = correlation(runtimes, revenues);
-    cout << "Correlation between revenue and popularity: " << endl;
-    CorrelationResult revenue_popularity = correlation(revenues, popularities);
-    cout << "Correlation between imdb_rating and popularity: " << endl;
-    CorrelationResult imdb_rating_popularities = correlation(imdb_ratings, popularities);
-    cout << "Correlation between revenue and imdb_rating: " << endl;
-    CorrelationResult revenue_imdb_ratings = correlation(revenues, imdb_ratings);
-    cout << "Correlation between budget and revenue: " << endl;
-    CorrelationResult budget_revenue = correlation(budget, revenues);
-    cout << "Correlation between budget and runtime: " << endl;
-    CorrelationResult budget_runtime = correlation(budget, runtimes);
-    cout << "Correlation between budget and popularity: " << endl;
-    CorrelationResult budget_popularity = correlation(budget, popularities);
-    cout << "Correlation between budget and imdb_ratings: " << endl;
-    CorrelationResult budget_imdb_rating = correlation(budget, imdb_ratings);
-    cout << "\n"
-         << endl;
-
-    // Output detailed information about correlations
-    cout << "Correlation between runtime and IMDb rating: " << runtime_imdb.correlation_coefficient << endl;
-    cout << "Correlation between runtime and popularity: " << runtime_popularities.correlation_coefficient << endl;
-    cout << "Correlation between runtime and revenue: " << runtime_revenues.correlation_coefficient << endl;
-    cout << "Correlation between revenue and popularity: " << revenue_popularity.correlation_coefficient << endl;
-    cout << "Correlation between revenue and imdb_rating: " << revenue_imdb_ratings.correlation_coefficient << endl;
-    cout << "Correlation between imdb_rating and popularity: " << imdb_rating_popularities.correlation_coefficient << endl;
-    cout << "Correlation between budget and revenue: " << budget_revenue.correlation_coefficient << endl;
-    cout << "Correlation between budget and runtime: " << budget_runtime.correlation_coefficient << endl;
-    cout << "Correlation between budget and popularity: " << budget_popularity.correlation_coefficient << endl;
-    cout << "Correlation between budget and imdb_ratings: " << budget_imdb_rating.correlation_coefficient << endl;
-
-    // Displaying language dstribution
-    languageDistribution(movies);
-
-    // Count word frequencies in movie titles
-    vector<WordFrequency> wordFreq = countWords(movies, ignoredWords);
-
-    // Sorting the word frequencies using Merge Sort
-    mergeSort(wordFreq, 0, wordFreq.size() - 1);
-
-    // Display the top 30 most common words
-    displayTopWords(wordFreq, 30);
-
-    // Count word frequencies in movie taglines according to original language, excluding ignored languages
-    vector<vector<WordFrequency>> titleWordFreqByLanguage = countTitleWordsByOriginalLanguage(movies, ignoredLanguages, ignoredWords);
-
-    // Sort word frequencies for each language entry using quick sort
-    for (auto &languageEntry : titleWordFreqByLanguage)
+    // Every parallel stage runs on this one pool, sized by --threads
+    WorkStealingPool pool(options.threads);
+    if (options.bench)
     {
-        mergeSort(languageEntry, 1, languageEntry.size() - 1);
+        return runBenchmarks(options, pool, remove_quotes, ignoredLanguages, ignoredWords);
     }
 
-    // Display word frequencies for each original language
-    displayWordFreqByLanguage(titleWordFreqByLanguage, 5);
-    // Display top 5 words for each language
-
-    // Count word frequencies in movie titles segregated by year
-    vector<pair<int, vector<WordFrequency>>> yearTitleWordFreq = countTitleWordsByYear(movies, ignoredWords);
-
-    // Sort word frequencies for each year entry
-    sortWordFrequenciesByYear(yearTitleWordFreq);
-
-    // Display top 5 words in titles segregated by year
-    displayTopWordsByYear(yearTitleWordFreq, 25);
-
-    // Sort movies by revenue using merge sort
-    movies = mergeSortMovie(movies, "revenue");
-
-    // Print the top 10 movies by revenue
-    printTopMoviesByRevenue(movies, 10);
+    // The server keeps the table for the requests that read movies directly
+    if (!options.serve.empty())
+    {
+        MovieTable movies = loadMovies(options, pool, remove_quotes, reportColumns(ALL_REPORTS));
+        ReportServer server(movies, computeReportState(movies, ignoredLanguages, ignoredWords, pool, 0, ALL_REPORTS), pool);
+        return serve(options.serve, server, options.workers);
+    }
 
-    string column = "popularity";
-    movies = mergeSortMovie(movies, column);
-    int count = 0;
-    // Print the top 10 movies by popularity
-    printTopMoviesByPopularity(movies, 10);
+    // A full run counts every movie, loaded whole or streamed in batches; an append merges the new movies into
+    // the state saved by earlier appends
+    ReportState state;
+    if (options.stream && options.append.empty())
+    {
+        state = streamReportState(options, pool, remove_quotes, ignoredLanguages, ignoredWords);
+    }
+    else if (options.append.empty())
+    {
+        MovieTable movies = loadMovies(options, pool, remove_quotes, reportColumns(options.reports));
+        state = computeReportState(movies, ignoredLanguages, ignoredWords, pool, 0, options.reports);
+    }
+    else
+    {
+        uint64_t config_hash = reportConfigHash(remove_quotes, ignoredWords, ignoredLanguages, options.reports);
+        if (!appendToState(options, pool, remove_quotes, ignoredLanguages, ignoredWords, config_hash, state))
+        {
+            return 1;
+        }
+    }
+    printReports(state, options.correlation_matrix, options.reports);
 
     return 0;
 }
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        return 1;
+    }
+    if (!options.profile.empty())
+    {
+        profiler.enable();
+    }
+    int status = run(options);
+    if (profiler.enabled())
+    {
+        ofstream out;
+        if (options.profile != "-")
+        {
+            out.open(options.profile);
+        }
+        profiler.write(options.profile == "-" ? cerr : out);
+    }
+    return status;
+}